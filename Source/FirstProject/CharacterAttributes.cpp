@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CharacterAttributes.h"
+#include "FirstProject.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attribute Propagations"), STAT_AttributePropagations, STATGROUP_Gameplay);
+
+
+FCharacterAttributes::FCharacterAttributes()
+{
+	FMemory::Memzero(Values);
+	DirtyMask = 0;
+}
+
+// Called by AMainCharacter whenever a stat is modified
+void FCharacterAttributes::Set(ECharacterAttribute Attribute, float Value)
+{
+	float& Current = Values[(int32)Attribute];
+	if (Current == Value) return;
+
+	Current = Value;
+	DirtyMask |= 1u << (int32)Attribute;
+}
+
+// Called by AMainCharacter once per frame and before saving
+int32 FCharacterAttributes::Flush()
+{
+	// Bits cleared before the broadcasts, an attribute set again by a listener goes to the next flush
+	uint32 Mask = DirtyMask;
+	DirtyMask = 0;
+
+	int32 NumPropagations = 0;
+	while (Mask != 0)
+	{
+		const int32 Index = FMath::CountTrailingZeros(Mask);
+		Mask &= Mask - 1;
+
+		OnAttributeChanged.Broadcast((ECharacterAttribute)Index, Values[Index]);
+		++NumPropagations;
+	}
+	INC_DWORD_STAT_BY(STAT_AttributePropagations, NumPropagations);
+	return NumPropagations;
+}
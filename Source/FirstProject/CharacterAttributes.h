@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Stats of the main character in one compact block, with a dirty bit per attribute. Setting a value only marks it
+ * dirty when it changes, and Flush() broadcasts OnAttributeChanged once per dirty attribute, so the consumers
+ * (HUD values, movement speed, save snapshot) only do work for the values that changed since the last flush.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CharacterAttributes.generated.h"
+
+/** Enum to name the attributes of the character */
+UENUM(BlueprintType)
+enum class ECharacterAttribute : uint8
+{
+	ECA_Health UMETA(DisplayName = "Health"),
+	ECA_MaxHealth UMETA(DisplayName = "MaxHealth"),
+	ECA_Stamina UMETA(DisplayName = "Stamina"),
+	ECA_MaxStamina UMETA(DisplayName = "MaxStamina"),
+	ECA_Coins UMETA(DisplayName = "Coins"),
+	ECA_MoveSpeed UMETA(DisplayName = "MoveSpeed"),
+	ECA_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
+/** Attribute that changed and its new value */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCharacterAttributeChanged, ECharacterAttribute, float);
+
+struct FIRSTPROJECT_API FCharacterAttributes
+{
+public:
+	FCharacterAttributes();
+
+	static constexpr int32 NumAttributes = (int32)ECharacterAttribute::ECA_MAX;
+
+	FORCEINLINE float Get(ECharacterAttribute Attribute) const { return Values[(int32)Attribute]; }
+
+	/** Sets the value, the attribute is only marked dirty when the value changes */
+	void Set(ECharacterAttribute Attribute, float Value);
+
+	FORCEINLINE bool IsDirty(ECharacterAttribute Attribute) const { return (DirtyMask & (1u << (int32)Attribute)) != 0; }
+
+	/** Marks every attribute dirty, so the next flush sends the full state (first flush, load) */
+	FORCEINLINE void MarkAllDirty() { DirtyMask = (1u << NumAttributes) - 1; }
+
+	/** Broadcasts OnAttributeChanged for every dirty attribute and clears the dirty bits
+	/* @return number of propagations, also added to the "Attribute Propagations" counter of "stat Gameplay" */
+	int32 Flush();
+
+	/** Called by Flush() for every attribute that changed */
+	FOnCharacterAttributeChanged OnAttributeChanged;
+
+private:
+	float Values[NumAttributes];
+
+	/** One bit per attribute */
+	uint32 DirtyMask;
+};
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatAudioSubsystem.h"
+#include "FirstProject.h"
+#include "Sound/SoundBase.h"
+#include "Sound/SoundAttenuation.h"
+#include "Components/AudioComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combat Audio"), STAT_CombatAudio, STATGROUP_CombatAudio);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Voices"), STAT_CombatVoices, STATGROUP_CombatAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Combat Sounds Played"), STAT_CombatSoundsPlayed, STATGROUP_CombatAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Combat Sounds Culled"), STAT_CombatSoundsCulled, STATGROUP_CombatAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Combat Voices Stolen"), STAT_CombatVoicesStolen, STATGROUP_CombatAudio);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Combat Sounds Dropped"), STAT_CombatSoundsDropped, STATGROUP_CombatAudio);
+
+
+// Sets default values
+UCombatAudioSubsystem::UCombatAudioSubsystem()
+{
+	// Defaults, can be overridden in DefaultGame.ini
+	MaxVoicesPerCue = 4;
+	CullDistance = 4000.f;
+	DefaultAttenuationSettings = nullptr;
+	NumVoices = 0;
+}
+
+// Returns the combat audio of the world the object lives in
+UCombatAudioSubsystem* UCombatAudioSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatAudioSubsystem>() : nullptr;
+}
+
+// Called by the actors instead of UGameplayStatics::PlaySound2D()
+void UCombatAudioSubsystem::PlayCue(const UObject* WorldContextObject, USoundBase* Sound, const FVector& Location, float Priority)
+{
+	if (Sound == nullptr) return;
+
+	if (UCombatAudioSubsystem* CombatAudio = Get(WorldContextObject))
+	{
+		CombatAudio->PlaySoundAtLocation(Sound, Location, Priority);
+		return;
+	}
+	UGameplayStatics::PlaySound2D(WorldContextObject, Sound);
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UCombatAudioSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the subsystem is created for the world
+void UCombatAudioSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	DefaultAttenuationSettings = Cast<USoundAttenuation>(DefaultAttenuation.TryLoad());
+	if (DefaultAttenuationSettings == nullptr)
+	{
+		// No asset set in DefaultGame.ini, spatialised sphere fading out up to the cull distance
+		DefaultAttenuationSettings = NewObject<USoundAttenuation>(this, TEXT("CombatDefaultAttenuation"), RF_Transient);
+		FSoundAttenuationSettings& Settings = DefaultAttenuationSettings->Attenuation;
+		Settings.bAttenuate = true;
+		Settings.bSpatialize = true;
+		Settings.AttenuationShape = EAttenuationShape::Sphere;
+		Settings.AttenuationShapeExtents = FVector::ZeroVector;
+		Settings.FalloffDistance = CullDistance;
+	}
+}
+
+// Called when the world is torn down, the audio components go away with it
+void UCombatAudioSubsystem::Deinitialize()
+{
+	Voices.Empty();
+	NumVoices = 0;
+	SET_DWORD_STAT(STAT_CombatVoices, 0);
+
+	Super::Deinitialize();
+}
+
+// Called by PlayCue()
+UAudioComponent* UCombatAudioSubsystem::PlaySoundAtLocation(USoundBase* Sound, const FVector& Location, float Priority)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CombatAudio);
+
+	UWorld* World = GetWorld();
+	if (Sound == nullptr || !World->bAllowAudioPlayback) return nullptr;
+
+	// Listener of the local player, the camera most of the time
+	FVector ListenerLocation = Location;
+	if (APlayerController* PlayerController = World->GetFirstPlayerController())
+	{
+		FVector FrontDir, RightDir;
+		PlayerController->GetAudioListenerPosition(ListenerLocation, FrontDir, RightDir);
+	}
+
+	// Culled before a voice exists, the attenuation of the cue decides how far it can be heard
+	USoundAttenuation* Attenuation = Sound->AttenuationSettings ? nullptr : DefaultAttenuationSettings;
+	float MaxDistance = CullDistance;
+	if (Sound->AttenuationSettings)
+	{
+		MaxDistance = Sound->GetMaxDistance();
+	}
+	else if (Attenuation)
+	{
+		MaxDistance = Attenuation->Attenuation.GetMaxDimension();
+	}
+	const float Distance = FVector::Dist(ListenerLocation, Location);
+	if (Distance > MaxDistance)
+	{
+		INC_DWORD_STAT(STAT_CombatSoundsCulled);
+		return nullptr;
+	}
+
+	// Closer voices matter more
+	const float EffectivePriority = Priority * (1.f - Distance / FMath::Max(MaxDistance, 1.f));
+
+	// Finished voices give their slot back
+	PruneFinishedVoices();
+	TArray<FVoice>& CueVoices = Voices.FindOrAdd(Sound);
+
+	// Concurrency limit of the cue, the new voice steals the lowest priority one or is dropped
+	if (CueVoices.Num() >= MaxVoicesPerCue && CueVoices.Num() > 0)
+	{
+		int32 Lowest = 0;
+		for (int32 i = 1; i < CueVoices.Num(); ++i)
+		{
+			if (CueVoices[i].Priority < CueVoices[Lowest].Priority)
+			{
+				Lowest = i;
+			}
+		}
+		if (CueVoices[Lowest].Priority > EffectivePriority)
+		{
+			INC_DWORD_STAT(STAT_CombatSoundsDropped);
+			SET_DWORD_STAT(STAT_CombatVoices, NumVoices);
+			return nullptr;
+		}
+
+		if (UAudioComponent* Stolen = CueVoices[Lowest].Component.Get())
+		{
+			Stolen->Stop();
+		}
+		CueVoices.RemoveAtSwap(Lowest, 1, false);
+		--NumVoices;
+		INC_DWORD_STAT(STAT_CombatVoicesStolen);
+	}
+
+	UAudioComponent* Component = UGameplayStatics::SpawnSoundAtLocation(World, Sound, Location, FRotator::ZeroRotator, 1.f, 1.f, 0.f, Attenuation);
+	if (Component)
+	{
+		CueVoices.Add({ Component, EffectivePriority });
+		++NumVoices;
+		INC_DWORD_STAT(STAT_CombatSoundsPlayed);
+	}
+	SET_DWORD_STAT(STAT_CombatVoices, NumVoices);
+	return Component;
+}
+
+// Called by PlaySoundAtLocation(), removes the voices of every cue that stopped playing
+void UCombatAudioSubsystem::PruneFinishedVoices()
+{
+	for (auto It = Voices.CreateIterator(); It; ++It)
+	{
+		TArray<FVoice>& CueVoices = It.Value();
+		for (int32 i = CueVoices.Num() - 1; i >= 0; --i)
+		{
+			UAudioComponent* Component = CueVoices[i].Component.Get();
+			if (Component == nullptr || !Component->IsPlaying())
+			{
+				CueVoices.RemoveAtSwap(i, 1, false);
+				--NumVoices;
+			}
+		}
+		if (CueVoices.Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
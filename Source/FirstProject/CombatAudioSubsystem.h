@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that plays the combat sounds (hits, swings, equips, pickups, explosions) at their location
+ * instead of as 2D sounds. Sounds too far from the listener to be heard are culled before a voice is allocated,
+ * and every cue has a limit of voices playing at the same time: a new voice with a higher priority (base priority
+ * scaled by how close it is to the listener) steals the lowest priority voice of the cue, otherwise it is dropped.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatAudioSubsystem.generated.h"
+
+class USoundBase;
+class USoundAttenuation;
+class UAudioComponent;
+
+/**
+ * Settings are read from the [/Script/FirstProject.CombatAudioSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UCombatAudioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UCombatAudioSubsystem();
+
+	/** Helper to get the combat audio of the world the object lives in */
+	static UCombatAudioSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Plays the cue through the combat audio of the world of the object, as a 2D sound when there is none (editor preview worlds)
+	/* @param Priority: base priority of the voice, the sounds of the player use a higher one than the enemies */
+	static void PlayCue(const UObject* WorldContextObject, USoundBase* Sound, const FVector& Location, float Priority = 1.f);
+
+	/** Only create the subsystem for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, loads or builds the default attenuation */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Inherited from UWorldSubsystem, forgets the voices */
+	virtual void Deinitialize() override;
+
+	/** Plays the cue at the location, returns the audio component or nullptr when the sound was culled or dropped */
+	UAudioComponent* PlaySoundAtLocation(USoundBase* Sound, const FVector& Location, float Priority);
+
+	/** Max voices of one cue playing at the same time */
+	UPROPERTY(config)
+	int32 MaxVoicesPerCue;
+
+	/** Distance to the listener past which the cues without attenuation are culled */
+	UPROPERTY(config)
+	float CullDistance;
+
+	/** Attenuation used for the cues that don't have one, so every combat sound is spatialised.
+	/* When empty, a spherical attenuation fading out up to CullDistance is built at startup */
+	UPROPERTY(config)
+	FSoftObjectPath DefaultAttenuation;
+
+private:
+	/** Voice playing a cue */
+	struct FVoice
+	{
+		TWeakObjectPtr<UAudioComponent> Component;
+		float Priority;
+	};
+
+	/** Removes the finished voices of every cue, so NumVoices only counts the live ones */
+	void PruneFinishedVoices();
+
+	/** Voices by cue, the finished ones are removed every time a cue plays */
+	TMap<TWeakObjectPtr<USoundBase>, TArray<FVoice>> Voices;
+
+	UPROPERTY()
+	USoundAttenuation* DefaultAttenuationSettings;
+
+	int32 NumVoices;
+};
@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CombatQuerySubsystem.h"
+#include "FirstProject.h"
+#include "Components/BoxComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combat Queries"), STAT_CombatQueries, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Melee Swings"), STAT_ActiveMeleeSwings, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Combat Volumes"), STAT_ActiveCombatVolumes, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Queries Submitted"), STAT_CombatQueriesSubmitted, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Hits Delivered"), STAT_CombatHitsDelivered, STATGROUP_Gameplay);
+
+static TAutoConsoleVariable<int32> CVarCombatQueries(
+	TEXT("fp.CombatQueries"),
+	1,
+	TEXT("0: weapon and enemy hitboxes and hazards use overlap events,\n")
+	TEXT("1: hitboxes are swept between frames and hazards tested with overlaps, all batched as async queries.\n")
+	TEXT("Applied the next time a hitbox is activated or a hazard spawns"));
+
+
+// Sets default values
+UCombatQuerySubsystem::UCombatQuerySubsystem()
+{
+	// Defaults, can be overridden in DefaultGame.ini
+	MaxStepDistance = 20.f;
+	MaxStepAngle = 15.f;
+	MaxSubsteps = 8;
+	NextId = 0;
+}
+
+// Returns the combat queries of the world the object lives in
+UCombatQuerySubsystem* UCombatQuerySubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatQuerySubsystem>() : nullptr;
+}
+
+// Called by the weapon and the enemy when activating their hitbox and by the hazards when they spawn
+bool UCombatQuerySubsystem::UseCombatQueries()
+{
+	return CVarCombatQueries.GetValueOnGameThread() != 0;
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UCombatQuerySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the world is torn down
+void UCombatQuerySubsystem::Deinitialize()
+{
+	Swings.Empty();
+	Volumes.Empty();
+	PendingQueries.Empty();
+	PendingHits.Empty();
+
+	Super::Deinitialize();
+}
+
+// Only tick while something is swinging, a volume is registered or queries are in flight
+bool UCombatQuerySubsystem::IsTickable() const
+{
+	return !IsTemplate() && (Swings.Num() > 0 || Volumes.Num() > 0 || PendingQueries.Num() > 0);
+}
+
+// Stat used by the engine to time the tickable object
+TStatId UCombatQuerySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatQuerySubsystem, STATGROUP_Tickables);
+}
+
+// Called every frame after the actors ticked, the hitboxes are where the animations of this frame put them
+void UCombatQuerySubsystem::Tick(float DeltaTime)
+{
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CombatQueries);
+		GatherResults();
+	}
+
+	// Before submitting, the callbacks can end swings (a hit enemy dies) or register volumes
+	DispatchHits();
+
+	SCOPE_CYCLE_COUNTER(STAT_CombatQueries);
+
+	// Swings are kept in order, an ended swing goes away once its last sweeps were read
+	Swings.RemoveAll([](const FSwing& Swing) { return (Swing.bEnded && Swing.NumPendingQueries == 0) || !Swing.Hitbox.IsValid(); });
+	Volumes.RemoveAll([](const FVolume& Volume) { return !Volume.Component.IsValid(); });
+
+	for (FSwing& Swing : Swings)
+	{
+		if (!Swing.bEnded)
+		{
+			SubmitSweep(Swing);
+		}
+	}
+	for (const FVolume& Volume : Volumes)
+	{
+		SubmitOverlap(Volume);
+	}
+
+	SET_DWORD_STAT(STAT_ActiveMeleeSwings, Swings.Num());
+	SET_DWORD_STAT(STAT_ActiveCombatVolumes, Volumes.Num());
+}
+
+// Called by AWeapon::ActivateHitbox() and AEnemy::ActivateHitbox()
+void UCombatQuerySubsystem::BeginSweep(UBoxComponent* Hitbox, AActor* IgnoredActor, const FOnCombatQueryHit& OnHit)
+{
+	if (Hitbox == nullptr) return;
+	CancelSweep(Hitbox); // A new swing starts before the previous one ended, the hit actors can be hit again
+
+	// The first sweep starts here, so the targets already inside the hitbox are hit too
+	FSwing& Swing = Swings.AddDefaulted_GetRef();
+	Swing.Id = NextId++;
+	Swing.Hitbox = Hitbox;
+	Swing.PreviousTransform = Hitbox->GetComponentTransform();
+	Swing.Params = FCollisionQueryParams(SCENE_QUERY_STAT(MeleeSweep), false, Hitbox->GetOwner());
+	Swing.Params.AddIgnoredActor(IgnoredActor);
+	Swing.OnHit = OnHit;
+	Swing.NumPendingQueries = 0;
+	Swing.bEnded = false;
+	Swing.bCancelled = false;
+}
+
+// Called by AWeapon::DeactivateHitbox() and AEnemy::DeactivateHitbox()
+void UCombatQuerySubsystem::EndSweep(UBoxComponent* Hitbox)
+{
+	for (FSwing& Swing : Swings)
+	{
+		if (Swing.Hitbox.Get() == Hitbox && !Swing.bEnded)
+		{
+			// The hitbox moved since the last frame, that part of the swing can still hit
+			SubmitSweep(Swing);
+			Swing.bEnded = true;
+		}
+	}
+}
+
+// Called when the owner of the hitbox dies while swinging
+void UCombatQuerySubsystem::CancelSweep(UBoxComponent* Hitbox)
+{
+	for (FSwing& Swing : Swings)
+	{
+		if (Swing.Hitbox.Get() == Hitbox)
+		{
+			Swing.bEnded = true;
+			Swing.bCancelled = true;
+		}
+	}
+}
+
+// Called by AExplosionHazard::BeginPlay()
+void UCombatQuerySubsystem::RegisterVolume(UPrimitiveComponent* Volume, const FOnCombatQueryHit& OnHit)
+{
+	if (Volume == nullptr) return;
+	UnregisterVolume(Volume);
+
+	FVolume& NewVolume = Volumes.AddDefaulted_GetRef();
+	NewVolume.Id = NextId++;
+	NewVolume.Component = Volume;
+	NewVolume.Params = FCollisionQueryParams(SCENE_QUERY_STAT(CombatVolume), false, Volume->GetOwner());
+	NewVolume.OnHit = OnHit;
+}
+
+// Called when the volume stops reacting to actors
+void UCombatQuerySubsystem::UnregisterVolume(UPrimitiveComponent* Volume)
+{
+	Volumes.RemoveAll([Volume](const FVolume& Other) { return Other.Component.Get() == Volume; });
+}
+
+// Called by Tick(), the queries are read in the order they were submitted so the hits always come in the same order
+void UCombatQuerySubsystem::GatherResults()
+{
+	UWorld* World = GetWorld();
+
+	int32 NumKept = 0;
+	for (int32 i = 0; i < PendingQueries.Num(); ++i)
+	{
+		FPendingQuery& Query = PendingQueries[i];
+
+		if (Query.bOverlap)
+		{
+			FOverlapDatum Datum;
+			if (!World->QueryOverlapData(Query.Handle, Datum))
+			{
+				if (Query.Age++ == 0) PendingQueries[NumKept++] = Query; // Not ready yet, one more frame
+				continue;
+			}
+
+			FVolume* Volume = FindVolume(Query.OwnerId);
+			if (Volume == nullptr || !Volume->Component.IsValid()) continue;
+
+			// Sorted so the actors entering on the same frame are reported in the same order every time
+			TArray<AActor*, TInlineAllocator<8>> Actors;
+			for (const FOverlapResult& Overlap : Datum.OutOverlaps)
+			{
+				if (AActor* Actor = Overlap.GetActor())
+				{
+					Actors.AddUnique(Actor);
+				}
+			}
+			Actors.Sort([](const AActor& A, const AActor& B) { return A.GetUniqueID() < B.GetUniqueID(); });
+
+			UPrimitiveComponent* Component = Volume->Component.Get();
+			for (AActor* Actor : Actors)
+			{
+				if (Volume->OverlappingActors.Contains(Actor)) continue;
+
+				const FHitResult Hit(Actor, nullptr, Component->GetComponentLocation(), FVector::UpVector);
+				PendingHits.Emplace(Volume->OnHit, Hit);
+			}
+
+			Volume->OverlappingActors.Reset();
+			for (AActor* Actor : Actors)
+			{
+				Volume->OverlappingActors.Add(Actor);
+			}
+		}
+		else
+		{
+			FSwing* Swing = FindSwing(Query.OwnerId);
+			FTraceDatum Datum;
+			if (!World->QueryTraceData(Query.Handle, Datum))
+			{
+				if (Swing && Query.Age++ == 0)
+				{
+					PendingQueries[NumKept++] = Query; // Not ready yet, one more frame
+					continue;
+				}
+				if (Swing) --Swing->NumPendingQueries;
+				continue;
+			}
+			if (Swing == nullptr) continue;
+			--Swing->NumPendingQueries;
+			if (Swing->bCancelled) continue;
+
+			// Earliest hits first, ties broken by actor so the order never changes
+			Datum.OutHits.Sort([](const FHitResult& A, const FHitResult& B)
+			{
+				if (A.Time != B.Time) return A.Time < B.Time;
+				const AActor* ActorA = A.GetActor();
+				const AActor* ActorB = B.GetActor();
+				return (ActorA ? ActorA->GetUniqueID() : 0) < (ActorB ? ActorB->GetUniqueID() : 0);
+			});
+
+			for (const FHitResult& Hit : Datum.OutHits)
+			{
+				AActor* HitActor = Hit.GetActor();
+				if (HitActor == nullptr || Swing->HitActors.Contains(HitActor)) continue;
+
+				Swing->HitActors.Add(HitActor);
+				PendingHits.Emplace(Swing->OnHit, Hit);
+			}
+		}
+	}
+	PendingQueries.SetNum(NumKept, false);
+}
+
+// Called for every active swing, more samples for the frames where the hitbox moves or turns a lot
+// so the frame rate doesn't change what gets hit
+void UCombatQuerySubsystem::SubmitSweep(FSwing& Swing)
+{
+	UBoxComponent* Hitbox = Swing.Hitbox.Get();
+	if (Hitbox == nullptr) return;
+	UWorld* World = GetWorld();
+
+	const FTransform CurrentTransform = Hitbox->GetComponentTransform();
+	const FVector Start = Swing.PreviousTransform.GetLocation();
+	const FVector End = CurrentTransform.GetLocation();
+	const FQuat StartRotation = Swing.PreviousTransform.GetRotation();
+	const FQuat EndRotation = CurrentTransform.GetRotation();
+	Swing.PreviousTransform = CurrentTransform;
+
+	const float Distance = FVector::Dist(Start, End);
+	const float Angle = FMath::RadiansToDegrees(StartRotation.AngularDistance(EndRotation));
+	const int32 NumSteps = FMath::Clamp(FMath::CeilToInt(FMath::Max(Distance / MaxStepDistance, Angle / MaxStepAngle)), 1, MaxSubsteps);
+
+	// Same objects the hitbox overlap events reacted to
+	const FCollisionObjectQueryParams ObjectParams(ECC_Pawn);
+	const FCollisionShape Box = FCollisionShape::MakeBox(Hitbox->GetScaledBoxExtent());
+
+	FVector StepStart = Start;
+	for (int32 Step = 1; Step <= NumSteps; ++Step)
+	{
+		const FVector StepEnd = FMath::Lerp(Start, End, (float)Step / NumSteps);
+		const FQuat StepRotation = FQuat::Slerp(StartRotation, EndRotation, (Step - 0.5f) / NumSteps);
+
+		FPendingQuery& Query = PendingQueries.AddDefaulted_GetRef();
+		Query.Handle = World->AsyncSweepByObjectType(EAsyncTraceType::Multi, StepStart, StepEnd, StepRotation, ObjectParams, Box, Swing.Params);
+		Query.OwnerId = Swing.Id;
+		Query.bOverlap = false;
+		Query.Age = 0;
+		++Swing.NumPendingQueries;
+
+		StepStart = StepEnd;
+	}
+
+	INC_DWORD_STAT_BY(STAT_CombatQueriesSubmitted, NumSteps);
+}
+
+// Called for every registered volume
+void UCombatQuerySubsystem::SubmitOverlap(const FVolume& Volume)
+{
+	UPrimitiveComponent* Component = Volume.Component.Get();
+
+	FPendingQuery& Query = PendingQueries.AddDefaulted_GetRef();
+	Query.Handle = GetWorld()->AsyncOverlapByObjectType(Component->GetComponentLocation(), Component->GetComponentQuat(),
+		FCollisionObjectQueryParams(ECC_Pawn), Component->GetCollisionShape(), Volume.Params);
+	Query.OwnerId = Volume.Id;
+	Query.bOverlap = true;
+	Query.Age = 0;
+
+	INC_DWORD_STAT(STAT_CombatQueriesSubmitted);
+}
+
+// Called after the results were read, the hit callbacks can start or end swings so they never run inside the query loops
+void UCombatQuerySubsystem::DispatchHits()
+{
+	if (PendingHits.Num() == 0) return;
+
+	TArray<TPair<FOnCombatQueryHit, FHitResult>> Hits = MoveTemp(PendingHits);
+	PendingHits.Reset();
+	for (const TPair<FOnCombatQueryHit, FHitResult>& Hit : Hits)
+	{
+		Hit.Key.ExecuteIfBound(Hit.Value);
+	}
+
+	INC_DWORD_STAT_BY(STAT_CombatHitsDelivered, Hits.Num());
+}
+
+// Swings and volumes are few, a linear search is enough
+UCombatQuerySubsystem::FSwing* UCombatQuerySubsystem::FindSwing(uint32 Id)
+{
+	return Swings.FindByPredicate([Id](const FSwing& Swing) { return Swing.Id == Id; });
+}
+
+UCombatQuerySubsystem::FVolume* UCombatQuerySubsystem::FindVolume(uint32 Id)
+{
+	return Volumes.FindByPredicate([Id](const FVolume& Volume) { return Volume.Id == Id; });
+}
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that runs the hit detection of the melee hitboxes (weapons, enemies) and of the hazard volumes
+ * as one batch of async physics queries per frame, instead of every actor relying on its own overlap events.
+ * While a hitbox is active its transform is recorded at the end of every frame and the box is swept from the previous
+ * transform to the new one in substeps, so fast swings don't pass through a target at low frame rates.
+ * Volumes are tested with an overlap every frame and report the actors that entered them.
+ * The queries run on the physics threads while the next frame runs, their hits are delivered at the end of
+ * that frame in the order the queries were submitted. Every actor is hit at most once per swing.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/EngineTypes.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+#include "CombatQuerySubsystem.generated.h"
+
+class UBoxComponent;
+
+/** Called once per actor hit during a swing or entering a volume */
+DECLARE_DELEGATE_OneParam(FOnCombatQueryHit, const FHitResult&);
+
+/**
+ * Settings are read from the [/Script/FirstProject.CombatQuerySubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UCombatQuerySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UCombatQuerySubsystem();
+
+	/** Helper to get the combat queries of the world the object lives in */
+	static UCombatQuerySubsystem* Get(const UObject* WorldContextObject);
+
+	/** True when the hitboxes and hazards should use the combat queries (fp.CombatQueries), false to go back to the overlap events */
+	static bool UseCombatQueries();
+
+	/** Only create the subsystem for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, drops the swings, volumes and queries in flight */
+	virtual void Deinitialize() override;
+
+	/** Inherited from FTickableGameObject, delivers the hits of the last batch and submits the next one
+	/* once the animations of the frame are done */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Starts a swing, the hitbox is swept every frame from where it is right now until EndSweep()
+	/* @param IgnoredActor: actor that can't be hit by the swing besides the owner of the hitbox (the weapon wielder) */
+	void BeginSweep(UBoxComponent* Hitbox, AActor* IgnoredActor, const FOnCombatQueryHit& OnHit);
+
+	/** Sweeps the hitbox up to where it is right now and ends the swing, the hits of that last sweep still arrive */
+	void EndSweep(UBoxComponent* Hitbox);
+
+	/** Ends the swing without sweeping again and drops the hits still in flight (owner died or was removed) */
+	void CancelSweep(UBoxComponent* Hitbox);
+
+	/** Tests the shape of the volume every frame until UnregisterVolume() or until the volume is destroyed */
+	void RegisterVolume(UPrimitiveComponent* Volume, const FOnCombatQueryHit& OnHit);
+	void UnregisterVolume(UPrimitiveComponent* Volume);
+
+	/** Max distance the hitbox moves between two sweep samples */
+	UPROPERTY(config)
+	float MaxStepDistance;
+
+	/** Max angle in degrees the hitbox turns between two sweep samples */
+	UPROPERTY(config)
+	float MaxStepAngle;
+
+	/** Max sweep samples per hitbox per frame */
+	UPROPERTY(config)
+	int32 MaxSubsteps;
+
+private:
+	/** Hitbox being swung */
+	struct FSwing
+	{
+		uint32 Id;
+		TWeakObjectPtr<UBoxComponent> Hitbox;
+		FTransform PreviousTransform;
+		FCollisionQueryParams Params;
+		FOnCombatQueryHit OnHit;
+		/** Actors already hit by this swing */
+		TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>> HitActors;
+		/** Sweeps of this swing still in flight, the swing is kept until they are read */
+		int32 NumPendingQueries;
+		bool bEnded;
+		bool bCancelled;
+	};
+
+	/** Volume tested every frame */
+	struct FVolume
+	{
+		uint32 Id;
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FCollisionQueryParams Params;
+		FOnCombatQueryHit OnHit;
+		/** Actors inside the volume on the last overlap */
+		TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>> OverlappingActors;
+	};
+
+	/** Query in flight */
+	struct FPendingQuery
+	{
+		FTraceHandle Handle;
+		uint32 OwnerId;
+		bool bOverlap;
+		/** Frames the results were not ready yet */
+		uint8 Age;
+	};
+
+	/** Reads the queries submitted on the previous frame and queues their new hits in submission order */
+	void GatherResults();
+
+	/** Starts the async sweeps of the hitbox from its previous transform to its current one */
+	void SubmitSweep(FSwing& Swing);
+
+	/** Starts the async overlap of the volume */
+	void SubmitOverlap(const FVolume& Volume);
+
+	/** Runs the hit callbacks queued by GatherResults() */
+	void DispatchHits();
+
+	FSwing* FindSwing(uint32 Id);
+	FVolume* FindVolume(uint32 Id);
+
+	/** Swings and volumes in the order they started, which is the order their hits are delivered in */
+	TArray<FSwing> Swings;
+	TArray<FVolume> Volumes;
+
+	TArray<FPendingQuery> PendingQueries;
+
+	/** Hits waiting for DispatchHits() */
+	TArray<TPair<FOnCombatQueryHit, FHitResult>> PendingHits;
+
+	/** Id given to the next swing or volume */
+	uint32 NextId;
+};
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DamageQueueSubsystem.h"
+#include "FirstProject.h"
+#include "Enemy.h"
+#include "MainCharacter.h"
+#include "GameFramework/Controller.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Resolution"), STAT_DamageResolution, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Submitted"), STAT_HitsSubmitted, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Applied"), STAT_HitsApplied, STATGROUP_Gameplay);
+
+
+// Sets default values
+UDamageQueueSubsystem::UDamageQueueSubsystem()
+{
+	// Default, can be overridden in DefaultGame.ini
+	SwingMemoryTime = 2.f;
+	NumHitsSubmitted = 0;
+	NumHitsApplied = 0;
+}
+
+// Returns the damage queue of the world the object lives in
+UDamageQueueSubsystem* UDamageQueueSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UDamageQueueSubsystem>() : nullptr;
+}
+
+// Called by AWeapon, AEnemy and AExplosionHazard instead of UGameplayStatics::ApplyDamage()
+bool UDamageQueueSubsystem::ApplyDamage(AActor* Victim, float Damage, AController* Instigator, AActor* Causer, TSubclassOf<UDamageType> DamageTypeClass, uint32 SwingId)
+{
+	if (UDamageQueueSubsystem* DamageQueue = Get(Causer))
+	{
+		return DamageQueue->QueueHit(Victim, Damage, Instigator, Causer, DamageTypeClass, SwingId);
+	}
+	UGameplayStatics::ApplyDamage(Victim, Damage, Instigator, Causer, DamageTypeClass);
+	return true;
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UDamageQueueSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the world is torn down, the hits still queued are dropped with it
+void UDamageQueueSubsystem::Deinitialize()
+{
+	QueuedHits.Empty();
+	RecentHits.Empty();
+
+	Super::Deinitialize();
+}
+
+// Only tick while there are hits to apply or swings to forget
+bool UDamageQueueSubsystem::IsTickable() const
+{
+	return !IsTemplate() && (QueuedHits.Num() > 0 || RecentHits.Num() > 0);
+}
+
+// Stat used by the engine to time the tickable object
+TStatId UDamageQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UDamageQueueSubsystem, STATGROUP_Tickables);
+}
+
+// Called every frame after the actors ticked
+void UDamageQueueSubsystem::Tick(float DeltaTime)
+{
+	ResolveHits();
+}
+
+// Called when a hitbox or a hazard hits an actor
+bool UDamageQueueSubsystem::QueueHit(AActor* Victim, float Damage, AController* Instigator, AActor* Causer, TSubclassOf<UDamageType> DamageTypeClass, uint32 SwingId)
+{
+	if (Victim == nullptr) return false;
+	++NumHitsSubmitted;
+	INC_DWORD_STAT(STAT_HitsSubmitted);
+
+	// A hitbox leaving and entering the victim again during the same attack doesn't hit twice
+	const FHitKey Key{ Causer, Victim, SwingId };
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (float* LastHitTime = RecentHits.Find(Key))
+	{
+		*LastHitTime = Now;
+		return false;
+	}
+	RecentHits.Add(Key, Now);
+
+	FQueuedHit& Hit = QueuedHits.AddDefaulted_GetRef();
+	Hit.Victim = Victim;
+	Hit.Causer = Causer;
+	Hit.Instigator = Instigator;
+	Hit.DamageTypeClass = DamageTypeClass;
+	Hit.Damage = Damage;
+	return true;
+}
+
+// Called by Tick(), damage and deaths for every hit of the frame in one pass, then one combat target update
+void UDamageQueueSubsystem::ResolveHits()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DamageResolution);
+
+	// Swings that stopped hitting a while ago are over
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (auto It = RecentHits.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value() > SwingMemoryTime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (QueuedHits.Num() == 0) return;
+
+	// Damage can queue new hits (an enemy dying ends its swing), they wait for the next frame
+	TArray<FQueuedHit> Hits = MoveTemp(QueuedHits);
+	QueuedHits.Reset();
+
+	TArray<AMainCharacter*, TInlineAllocator<2>> CombatTargetUpdates;
+	for (const FQueuedHit& Hit : Hits)
+	{
+		AActor* Victim = Hit.Victim.Get();
+		if (Victim == nullptr) continue;
+
+		// The enemy was already killed by an earlier hit of the frame
+		AEnemy* Enemy = Cast<AEnemy>(Victim);
+		if (Enemy && !Enemy->Alive()) continue;
+
+		// The causer can be gone already (hazards destroy themselves when they explode), it is still valid until the next garbage collection
+		AController* Instigator = Hit.Instigator.Get();
+		UGameplayStatics::ApplyDamage(Victim, Hit.Damage, Instigator, Hit.Causer.Get(true), Hit.DamageTypeClass);
+		++NumHitsApplied;
+		INC_DWORD_STAT(STAT_HitsApplied);
+
+		// The player killed the enemy, it picks a new combat target once all the hits are applied
+		if (Enemy && !Enemy->Alive() && Instigator)
+		{
+			if (AMainCharacter* MainCharacter = Cast<AMainCharacter>(Instigator->GetPawn()))
+			{
+				CombatTargetUpdates.AddUnique(MainCharacter);
+			}
+		}
+	}
+
+	for (AMainCharacter* MainCharacter : CombatTargetUpdates)
+	{
+		MainCharacter->UpdateCombatTarget();
+	}
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that collects the hits of the frame (weapons, enemies, hazards) and resolves them together
+ * at the end of the frame instead of calling ApplyDamage() from every overlap callback.
+ * Hits are deduplicated per attacker, swing and victim, so a hitbox overlapping a victim again during the same
+ * swing never deals its damage twice. Deaths are resolved in the same pass and the combat target of the player
+ * is refreshed once after it, however many enemies died.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Templates/SubclassOf.h"
+#include "DamageQueueSubsystem.generated.h"
+
+class UDamageType;
+
+/**
+ * Settings are read from the [/Script/FirstProject.DamageQueueSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UDamageQueueSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UDamageQueueSubsystem();
+
+	/** Helper to get the damage queue of the world the object lives in */
+	static UDamageQueueSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Queues the hit in the damage queue of the world of the causer, applies it right away when there is no queue (editor preview worlds)
+	/* @return false when the causer already hit the victim during the swing, the hit effects aren't played again */
+	static bool ApplyDamage(AActor* Victim, float Damage, AController* Instigator, AActor* Causer, TSubclassOf<UDamageType> DamageTypeClass, uint32 SwingId);
+
+	/** Only create the subsystem for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, drops the queued hits */
+	virtual void Deinitialize() override;
+
+	/** Inherited from FTickableGameObject, resolves the hits of the frame */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Queues a hit, ignored when the same causer already hit the victim during the swing
+	/* @param SwingId: attack of the causer the hit belongs to, increased by the causer every time it starts an attack
+	/* @return true when the hit was queued, false when it was ignored */
+	bool QueueHit(AActor* Victim, float Damage, AController* Instigator, AActor* Causer, TSubclassOf<UDamageType> DamageTypeClass, uint32 SwingId);
+
+	/** Applies the queued hits */
+	void ResolveHits();
+
+	/** Getters for the hit counters since the world started */
+	FORCEINLINE int32 GetNumHitsSubmitted() const { return NumHitsSubmitted; }
+	FORCEINLINE int32 GetNumHitsApplied() const { return NumHitsApplied; }
+
+	/** Seconds a swing is remembered after its last hit, has to be longer than the longest attack */
+	UPROPERTY(config)
+	float SwingMemoryTime;
+
+private:
+	/** Hit waiting for ResolveHits() */
+	struct FQueuedHit
+	{
+		TWeakObjectPtr<AActor> Victim;
+		TWeakObjectPtr<AActor> Causer;
+		TWeakObjectPtr<AController> Instigator;
+		UClass* DamageTypeClass;
+		float Damage;
+	};
+
+	/** Attacker, swing and victim of a hit */
+	struct FHitKey
+	{
+		const AActor* Causer;
+		const AActor* Victim;
+		uint32 SwingId;
+
+		friend bool operator==(const FHitKey& A, const FHitKey& B) { return A.Causer == B.Causer && A.Victim == B.Victim && A.SwingId == B.SwingId; }
+		friend uint32 GetTypeHash(const FHitKey& Key) { return HashCombine(HashCombine(GetTypeHash(Key.Causer), GetTypeHash(Key.Victim)), Key.SwingId); }
+	};
+
+	/** Hits in the order they were queued, which is the order they are applied in */
+	TArray<FQueuedHit> QueuedHits;
+
+	/** World time of the last hit of every recent attacker, swing and victim */
+	TMap<FHitKey, float> RecentHits;
+
+	int32 NumHitsSubmitted;
+	int32 NumHitsApplied;
+};
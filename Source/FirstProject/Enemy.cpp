@@ -1,36 +1,47 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Enemy.h"
-#include "Components/SphereComponent.h"
 #include "AIController.h"
+#include "Navigation/PathFollowingComponent.h"
 #include "MainCharacter.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Components/BoxComponent.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Components/PoseableMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Sound/SoundCue.h"
 #include "Animation/AnimInstance.h"
-#include "TimerManager.h"
+#include "GameplayTimerSubsystem.h"
 #include "Components/CapsuleComponent.h"
 #include "MainPlayerController.h"
+#include "EnemyManagerSubsystem.h"
+#include "EnemyPoolSubsystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "CombatQuerySubsystem.h"
+#include "DamageQueueSubsystem.h"
+#include "FXPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
+
+/** Turns off NavWalking for every enemy, to compare the cost of both modes with "stat CharacterMovement" */
+static TAutoConsoleVariable<int32> CVarEnemyNavWalking(
+	TEXT("fp.EnemyNavWalking"),
+	1,
+	TEXT("0: enemies always use the full walking movement, 1: enemies with bUseNavWalking move in NavWalking mode.\n")
+	TEXT("Applied to the living enemies by the enemy manager on the next frame"));
 
 
 
 // Sets default values
 AEnemy::AEnemy()
 {
-	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
-	// Setting up AgroSphere
-	AgroSphere = CreateDefaultSubobject<USphereComponent>(TEXT("AgroSphere"));
-	AgroSphere->SetupAttachment(GetRootComponent());
-	AgroSphere->SetCollisionResponseToChannel(ECollisionChannel::ECC_WorldDynamic, ECollisionResponse::ECR_Ignore);
-	AgroSphere->InitSphereRadius(600.f);
-	// Setting up CombatSphere
-	CombatSphere = CreateDefaultSubobject<USphereComponent>(TEXT("CombatSphere"));
-	CombatSphere->SetupAttachment(GetRootComponent());
-	CombatSphere->InitSphereRadius(100.f);
+	// Enemies don't tick on their own, UEnemyManagerSubsystem updates all of them in a single pass
+	PrimaryActorTick.bCanEverTick = false;
+	// Setting up the agro and combat ranges (the enemy manager checks them, no overlap components needed)
+	AgroRadius = 600.f;
+	CombatRadius = 100.f;
+	ProximityHysteresis = 25.f;
 	// Setting up attack hitbox
 	Hitbox = CreateDefaultSubobject<UBoxComponent>(TEXT("Hitbox"));
 	Hitbox->SetupAttachment(GetMesh(), FName("EnemySocket"));
@@ -42,7 +53,24 @@ AEnemy::AEnemy()
 	AttackMinTime = 0.5f;
 	AttackMaxTime = 2.f;
 	DeathDelay = 3.f;
+	CorpseMesh = nullptr;
+	CorpseFadeTime = 1.f;
+	CorpseFadeParameter = FName("Fade");
+	CorpseFadeStartTime = 0.f;
+	SwingId = 0;
 	bHasValidTarget = false;
+	bAttacking = false;
+	CombatTarget = nullptr;
+	ManagerIndex = INDEX_NONE;
+	HibernationIndex = INDEX_NONE;
+	NearestIndexSlot = INDEX_NONE;
+	bHasBeenAggroed = false;
+	bHibernating = false;
+	Significance = EEnemySignificance::ES_Full;
+	ReducedTickInterval = 0.1f;
+	bUseNavWalking = true;
+	NavWalkingResumeDelay = 1.f;
+	NavigationMode = EEnemyNavigationMode::ENM_MoveTo;
 	// Enum Initialization
 	EnemyMovementStatus = EEnemyMovementStatus::EMS_Idle;
 }
@@ -53,12 +81,6 @@ void AEnemy::BeginPlay()
 	Super::BeginPlay();
 	// Getting Reference of AI Controller
 	AIController = Cast<AAIController>(GetController());
-	// Enabling Overlap with AgroSphere
-	AgroSphere->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::AgroSphereOnOverlapBegin);
-	AgroSphere->OnComponentEndOverlap.AddDynamic(this, &AEnemy::AgroSphereOnOverlapEnd);
-	// Enabling Overlap with CombatSphere
-	CombatSphere->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::CombatSphereOnOverlapBegin);
-	CombatSphere->OnComponentEndOverlap.AddDynamic(this, &AEnemy::CombatSphereOnOverlapEnd);
 	// Enabling Overlap with attack hitbox
 	Hitbox->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::HitboxOnOverlapBegin);
 	Hitbox->OnComponentEndOverlap.AddDynamic(this, &AEnemy::HitboxOnOverlapEnd);
@@ -70,13 +92,85 @@ void AEnemy::BeginPlay()
 	// Disabling Collision response of the camera against the enemy mesh and capsule
 	GetMesh()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Camera, ECollisionResponse::ECR_Ignore);
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Camera, ECollisionResponse::ECR_Ignore);
+	// Saving the anim tick option from the Blueprint to restore it after lowering the significance
+	DefaultAnimTickOption = GetMesh()->VisibilityBasedAnimTickOption;
+	// Ground minions walk on the navmesh instead of doing floor sweeps
+	if (UsesNavWalking())
+	{
+		GetCharacterMovement()->DefaultLandMovementMode = MOVE_NavWalking;
+		GetCharacterMovement()->SetMovementMode(MOVE_NavWalking);
+	}
+	// Registering the enemy so it gets updated by the enemy manager
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->RegisterEnemy(this);
+	}
+}
+
+// Called when the enemy is destroyed or the level is unloaded
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Making sure the manager never keeps a reference to a removed enemy
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->UnregisterEnemy(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called by the character movement on every mode change
+void AEnemy::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+	// Full walking after landing or being hit, NavWalking again once the enemy stays on the ground for a moment
+	if (UsesNavWalking() && Alive() && GetCharacterMovement()->MovementMode == MOVE_Walking)
+	{
+		if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+		{
+			GameplayTimers->SetTimer(NavWalkingTimer, this, &AEnemy::ResumeNavWalking, NavWalkingResumeDelay);
+		}
+	}
+}
+
+// Called by NavWalkingTimer
+void AEnemy::ResumeNavWalking()
+{
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	if (UsesNavWalking() && Alive() && Movement->MovementMode == MOVE_Walking && Movement->IsMovingOnGround())
+	{
+		Movement->SetMovementMode(MOVE_NavWalking);
+	}
+}
+
+// Checks the enemy class setting and the console override
+bool AEnemy::UsesNavWalking() const
+{
+	return bUseNavWalking && IsNavWalkingAllowed();
+}
+
+// Reads the console override, polled by UEnemyManagerSubsystem to apply its changes
+bool AEnemy::IsNavWalkingAllowed()
+{
+	return CVarEnemyNavWalking.GetValueOnGameThread() != 0;
 }
 
-// Called every frame
-void AEnemy::Tick(float DeltaTime)
+// Called by UEnemyManagerSubsystem when fp.EnemyNavWalking changes
+void AEnemy::ApplyNavWalking()
 {
-	Super::Tick(DeltaTime);
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->DefaultLandMovementMode = UsesNavWalking() ? MOVE_NavWalking : MOVE_Walking;
+	if (!Alive() || !Movement->IsMovingOnGround()) return;
 
+	if (UsesNavWalking() && Movement->MovementMode == MOVE_Walking)
+	{
+		Movement->SetMovementMode(MOVE_NavWalking);
+	}
+	else if (!UsesNavWalking() && Movement->MovementMode == MOVE_NavWalking)
+	{
+		Movement->SetMovementMode(MOVE_Walking);
+	}
 }
 
 // Called to bind functionality to input
@@ -86,122 +180,129 @@ void AEnemy::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 
 }
 
-// Called when player enters the enemy AgroSphere, enemy starts chasing the player
-void AEnemy::AgroSphereOnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+// Called when player enters the enemy agro range, enemy starts chasing the player
+void AEnemy::AgroRangeBegin(AMainCharacter* MainCharacter)
 {
-	if (OtherActor && Alive())
+	if (MainCharacter && Alive())
 	{
-		AMainCharacter* MainCharacter = Cast<AMainCharacter>(OtherActor); // Geeting player character reference
-		if (MainCharacter)
-		{
-			MoveToTarget(MainCharacter); // Enemy chases player
-		}
+		bHasBeenAggroed = true; // The enemy won't hibernate anymore
+		MoveToTarget(MainCharacter); // Enemy chases player
 	}
 }
 
-//Called when player exits the enemy AgroSphere, enemy stops chasing the player
-void AEnemy::AgroSphereOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+//Called when player exits the enemy agro range (or the enemy dies), enemy stops chasing the player
+void AEnemy::AgroRangeEnd(AMainCharacter* MainCharacter)
 {
-	if (OtherActor)
+	if (MainCharacter)
 	{
-		AMainCharacter* MainCharacter = Cast<AMainCharacter>(OtherActor); // Casting MainCharacter
+		// Setting all variables related to chasing the player back to null/false
+		SetHasValidTarget(false);
+		if (MainCharacter->CombatTarget == this)
+		{
+			MainCharacter->SetCombatTarget(nullptr);
+		}
+		MainCharacter->SetHasCombatTarget(false);
+		MainCharacter->UpdateCombatTarget();
+
+		// Setting the enemy to the idle state and stoping it from moving
+		if (Alive())
 		{
-			if (MainCharacter)
+			SetEnemyMovementStatus(EEnemyMovementStatus::EMS_Idle);
+			if (AIController)
 			{
-				// Setting all variables related to chasing the player back to null/false
-				bHasValidTarget = false;
-				if (MainCharacter->CombatTarget == this)
-				{
-					MainCharacter->SetCombatTarget(nullptr);
-				}
-				MainCharacter->SetHasCombatTarget(false);
-				MainCharacter->UpdateCombatTarget();
-
-				// Setting the enemy to the idle state and stoping it from moving
-				SetEnemyMovementStatus(EEnemyMovementStatus::EMS_Idle);
-				if (AIController)
-				{
-					AIController->StopMovement();
-				}
+				AIController->StopMovement();
 			}
 		}
 	}
 }
 
-// Called when player enters the enemy CombatSphere, enemy starts attacking the player
-void AEnemy::CombatSphereOnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+// Called when player enters the enemy combat range, enemy starts attacking the player
+void AEnemy::CombatRangeBegin(AMainCharacter* MainCharacter)
 {
-	if (OtherActor && Alive())
+	if (MainCharacter && Alive())
 	{
-		AMainCharacter* MainCharacter = Cast<AMainCharacter>(OtherActor); // Casting MainCharacter
-		{
-			if (MainCharacter)
-			{
-				bOverlappingCombatSphere = true;
-				bHasValidTarget = true;
-				// Calling MainCharacter functions related to the interpolation and displaying enemy health bar during combat
-				MainCharacter->SetCombatTarget(this);
-				MainCharacter->SetHasCombatTarget(true);
-				MainCharacter->UpdateCombatTarget();
-				CombatTarget = MainCharacter;
-				// Setting a randomize time for the enemy to wait before attacking
-				float AttackTime = FMath::FRandRange(AttackMinTime, AttackMaxTime);
-				GetWorldTimerManager().SetTimer(AttackTimer, this, &AEnemy::Attack, AttackTime);
-			}
-		}
+		SetOverlappingCombatSphere(true);
+		SetHasValidTarget(true);
+		// Calling MainCharacter functions related to the interpolation and displaying enemy health bar during combat
+		MainCharacter->SetCombatTarget(this);
+		MainCharacter->SetHasCombatTarget(true);
+		MainCharacter->UpdateCombatTarget();
+		SetCombatTarget(MainCharacter);
+		// Setting a randomize time for the enemy to wait before attacking
+		ScheduleAttack(MainCharacter);
 	}
 }
 
-// Called when player exits the enemy CombatSphere, enemy stops attacking the player and goes back to chasing
-void AEnemy::CombatSphereOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+// Called when player exits the enemy combat range (or the enemy dies), enemy stops attacking the player and goes back to chasing
+void AEnemy::CombatRangeEnd(AMainCharacter* MainCharacter)
 {
-	if (OtherActor && OtherComp)
+	if (MainCharacter)
 	{
-		AMainCharacter* MainCharacter = Cast<AMainCharacter>(OtherActor); // Casting MainCharacter
+		SetOverlappingCombatSphere(false);
+		SetCombatTarget(nullptr);
+		if (Alive())
 		{
-			if (MainCharacter)
-			{
-				bOverlappingCombatSphere = false;
-				CombatTarget = nullptr;
-				MoveToTarget(MainCharacter); // Player is no longer close to the enemy so MoveToTarget is called
-
-				// Setting Main Character Interpolation related variables back to false/null until player enters the CombatSphere again
-				if (MainCharacter->CombatTarget == this)
-				{
-					MainCharacter->SetCombatTarget(nullptr);
-					MainCharacter->bHasCombatTarget = false;
-					MainCharacter->UpdateCombatTarget();
-				}
-
-				if (MainCharacter->MainPlayerController)
-				{
-					// Remove Enemy Health bar only if the component ending the overlap is the main characters mesh
-					USkeletalMeshComponent* MainMesh = Cast<USkeletalMeshComponent>(OtherComp);
-					if (MainMesh) MainCharacter->MainPlayerController->RemoveEnemyHealthBar();
-				}
-
-				// Clearing enemy attack timer if main character runs away
-				GetWorldTimerManager().ClearTimer(AttackTimer);
-			}
+			MoveToTarget(MainCharacter); // Player is no longer close to the enemy so MoveToTarget is called
+		}
+
+		// Setting Main Character Interpolation related variables back to false/null until player enters the combat range again
+		if (MainCharacter->CombatTarget == this)
+		{
+			MainCharacter->SetCombatTarget(nullptr);
+			MainCharacter->bHasCombatTarget = false;
+			MainCharacter->UpdateCombatTarget();
+		}
+
+		// Remove Enemy Health bar, UpdateCombatTarget() shows it again if another enemy is still in combat
+		if (MainCharacter->MainPlayerController && !MainCharacter->bHasCombatTarget)
+		{
+			MainCharacter->MainPlayerController->RemoveEnemyHealthBar();
+		}
+
+		// Clearing enemy queued attack if main character runs away
+		if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+		{
+			EnemyManager->GetCombatDirector().CancelAttack(this);
 		}
 	}
 }
 
-// Called by AgroSphereOnOverlapBegin(), in this function the AIController function called MoveTo is called
-// To utilize MoveTo two parameters are used, a FAIMoveRequest and a FNavPathSharedPtr
+// Called by AgroRangeBegin(), in this function the AIController function called RequestMove is called
+// with a path taken from the path cache of the enemy manager, shared with the other enemies chasing the same target.
+// In flow field mode there is no path, the enemy manager moves the enemy along the flow field every frame
 void AEnemy::MoveToTarget(AMainCharacter* Target)
 {
 	SetEnemyMovementStatus(EEnemyMovementStatus::EMS_MoveToTarget); // Setting enemy movement status to chase
 
 	if (AIController) // If AIController is Valid
 	{
+		UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this);
+		const bool bUseFlowField = EnemyManager && EnemyManager->UsesFlowField(this);
+		if (EnemyManager && ManagerIndex != INDEX_NONE)
+		{
+			EnemyManager->SetFlag(ManagerIndex, EEnemyFlags::FlowField, bUseFlowField); // The mode is picked for the whole chase
+		}
+		if (bUseFlowField)
+		{
+			AIController->StopMovement(); // Path following would fight the flow field input
+			return;
+		}
+
 		FAIMoveRequest MoveRequest; // FAIMoveRequest declared
 		MoveRequest.SetGoalActor(Target); // Setting GoalActor variable for FAIMoveRequest
 		MoveRequest.SetAcceptanceRadius(15.0f); // Setting AcceptanceRadius variable FAIMoveRequest
 
-		FNavPathSharedPtr NavPath; // FNavPathSharedPtr declared
+		// The path cache repaths the enemy when the target moves, so the path doesn't observe the goal on its own
+		FNavPathSharedPtr NavPath = EnemyManager ? EnemyManager->GetPathService().FindPath(this, MoveRequest) : nullptr;
 
-		AIController->MoveTo(MoveRequest, &NavPath); // Call MoveTo with the two parameters
+		if (NavPath.IsValid())
+		{
+			AIController->RequestMove(MoveRequest, NavPath); // Follow the cached path
+		}
+		else
+		{
+			AIController->MoveTo(MoveRequest, &NavPath); // Fallback when there is no navigation data for the cache
+		}
 
 		/**
 		// Experimenting with the PathPoints inside FNavPathSharedPtr using DebugSpheres
@@ -224,29 +325,45 @@ void AEnemy::HitboxOnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AAct
 		AMainCharacter* MainCharacter = Cast<AMainCharacter>(OtherActor); // Casting MainCharacter (to apply damage)
 		if (MainCharacter)
 		{
-			// Particles when the enemy hitbox hits the player
-			if (MainCharacter->HitParticles)
-			{
-				const USkeletalMeshSocket* TipSocket = GetMesh()->GetSocketByName("TipSocket"); // Creating the enemy socket reference
-				if (TipSocket)
-				{
-					// Spawning the particle system at the enemy socket
-					FVector SocketLocation = TipSocket->GetSocketLocation(GetMesh());
-					UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), MainCharacter->HitParticles, SocketLocation, FRotator(0.f), false);
-				}
-			}
-			// Playing the main character hit sound
-			if (MainCharacter->HitSound)
-			{
-				UGameplayStatics::PlaySound2D(this, MainCharacter->HitSound);
-			}
-			// Applying damage to main character
-			if (DamageTypeClass)
-			{
-				UGameplayStatics::ApplyDamage(MainCharacter, Damage, AIController, this, DamageTypeClass);
-			}
+			HitMainCharacter(MainCharacter);
+		}
+	}
+}
+
+// Called by the melee sweeps of UCombatQuerySubsystem once per actor the attack went through
+void AEnemy::HitboxOnSweepHit(const FHitResult& Hit)
+{
+	AMainCharacter* MainCharacter = Cast<AMainCharacter>(Hit.GetActor());
+	if (MainCharacter)
+	{
+		HitMainCharacter(MainCharacter);
+	}
+}
+
+// Called when the enemy hitbox overlaps or sweeps through the player
+void AEnemy::HitMainCharacter(AMainCharacter* MainCharacter)
+{
+	// Applying damage to main character, at the end of the frame and once per swing. No effects either when the swing already hit it
+	if (DamageTypeClass && !UDamageQueueSubsystem::ApplyDamage(MainCharacter, Damage, AIController, this, DamageTypeClass, SwingId))
+	{
+		return;
+	}
+	// Particles when the enemy hitbox hits the player
+	if (MainCharacter->HitParticles)
+	{
+		const USkeletalMeshSocket* TipSocket = GetMesh()->GetSocketByName("TipSocket"); // Creating the enemy socket reference
+		if (TipSocket)
+		{
+			// Playing the particle system at the enemy socket, from the effects pool
+			FVector SocketLocation = TipSocket->GetSocketLocation(GetMesh());
+			UFXPoolSubsystem::SpawnEffectAtLocation(this, MainCharacter->HitParticles, SocketLocation);
 		}
 	}
+	// Playing the main character hit sound
+	if (MainCharacter->HitSound)
+	{
+		UCombatAudioSubsystem::PlayCue(this, MainCharacter->HitSound, MainCharacter->GetActorLocation(), 1.5f);
+	}
 }
 
 // Function not used
@@ -258,25 +375,39 @@ void AEnemy::HitboxOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor
 // Called when enemy attacks (in Blueprints)
 void AEnemy::ActivateHitbox()
 {
-	Hitbox->SetCollisionEnabled(ECollisionEnabled::QueryOnly); // QueryOnly = Only overlap is enabled, no physics
+	++SwingId; // New attack, the player can be hit again
+	// Swept hits don't depend on the frame rate and run in the combat query batch, the overlap events are kept behind fp.CombatQueries 0
+	UCombatQuerySubsystem* CombatQueries = UCombatQuerySubsystem::Get(this);
+	if (CombatQueries && UCombatQuerySubsystem::UseCombatQueries())
+	{
+		CombatQueries->BeginSweep(Hitbox, nullptr, FOnCombatQueryHit::CreateUObject(this, &AEnemy::HitboxOnSweepHit));
+	}
+	else
+	{
+		Hitbox->SetCollisionEnabled(ECollisionEnabled::QueryOnly); // QueryOnly = Only overlap is enabled, no physics
+	}
 	if (SwingSound)
 	{
-		UGameplayStatics::PlaySound2D(this, SwingSound);
+		UCombatAudioSubsystem::PlayCue(this, SwingSound, GetActorLocation());
 	}
 }
 
 // Called after finishing an attack animation(in Blueprints)
 void AEnemy::DeactivateHitbox()
 {
+	if (UCombatQuerySubsystem* CombatQueries = UCombatQuerySubsystem::Get(this))
+	{
+		CombatQueries->EndSweep(Hitbox);
+	}
 	Hitbox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 }
 
-// Called by CombatSphereOnOverlapBegin() function on the last line (when GetWorldTimerManager() is called)
+// Called by the combat director of the enemy manager once the attack queued by ScheduleAttack() is due and a token is free
 void AEnemy::Attack()
 {
 	if (Alive() && bHasValidTarget && !bAttacking)
 	{
-		bAttacking = true;
+		SetAttacking(true);
 
 		if (AIController)
 		{
@@ -299,16 +430,31 @@ void AEnemy::Attack()
 // Called via Blueprint after combat montage animation ends
 void AEnemy::AttackEnd()
 {
-	bAttacking = false;
+	SetAttacking(false);
+	UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this);
+	if (EnemyManager)
+	{
+		EnemyManager->GetCombatDirector().ReleaseToken(this); // Another enemy can attack the player now
+	}
 	if (bOverlappingCombatSphere)
 	{
 		// Randomize how fast will the enemy attack again
-		float AttackTime = FMath::FRandRange(AttackMinTime, AttackMaxTime);
-		GetWorldTimerManager().SetTimer(AttackTimer, this, &AEnemy::Attack, AttackTime);
+		ScheduleAttack(CombatTarget);
 	}
 }
 
-// Called by ApplyDamage() in the HitboxOnOverlapBegin function of AWeapon
+// Called by CombatRangeBegin() and AttackEnd(), queues the next attack in the combat director after a random delay
+void AEnemy::ScheduleAttack(AMainCharacter* Target)
+{
+	UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this);
+	if (EnemyManager && Target)
+	{
+		const float AttackTime = FMath::FRandRange(AttackMinTime, AttackMaxTime);
+		EnemyManager->GetCombatDirector().ScheduleAttack(this, Target, GetWorld()->GetTimeSeconds() + AttackTime);
+	}
+}
+
+// Called by UDamageQueueSubsystem::ResolveHits() for the hits of the player weapon and the hazards
 float AEnemy::TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser)
 {
 	Health -= DamageAmount;
@@ -316,6 +462,10 @@ float AEnemy::TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEv
 	{
 		Die(DamageCauser);
 	}
+	else if (GetCharacterMovement()->MovementMode == MOVE_NavWalking)
+	{
+		GetCharacterMovement()->SetMovementMode(MOVE_Walking); // Full movement while reacting to the hit (knockbacks, physics)
+	}
 
 	return DamageAmount;
 }
@@ -323,7 +473,12 @@ float AEnemy::TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEv
 // Called when enemy Health Points reach 0
 void AEnemy::Die(AActor* Causer)
 {
-	bAttacking = false; // Stop attacking
+	SetAttacking(false); // Stop attacking
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->GetCombatDirector().CancelAttack(this);
+		EnemyManager->GetCombatDirector().ReleaseToken(this);
+	}
 	
 	// Playing Death animation from CombatMontage
 	SetEnemyMovementStatus(EEnemyMovementStatus::EMS_Dead);
@@ -334,10 +489,12 @@ void AEnemy::Die(AActor* Causer)
 		AnimInstance->Montage_JumpToSection(FName("Death"), CombatMontage);
 	}
 	
-	// Disabling all collisions of the enemy
+	// Disabling all collisions of the enemy, an attack in progress can't hit anymore
+	if (UCombatQuerySubsystem* CombatQueries = UCombatQuerySubsystem::Get(this))
+	{
+		CombatQueries->CancelSweep(Hitbox);
+	}
 	Hitbox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	AgroSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	CombatSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	
 	// Updating MainCharacter Combat target to change to another enemy
@@ -348,23 +505,309 @@ void AEnemy::Die(AActor* Causer)
 	}
 }
 
-// Called from Animation Blueprint after the enemy dies, pause animation and sets the timer to then call Disappear()
+// Called from Animation Blueprint after the enemy dies, bakes the corpse and sets the timer to then call Disappear()
 void AEnemy::DeathEnd()
 {
-	GetMesh()->bPauseAnims = true;
-	GetMesh()->bNoSkeletonUpdate = true;
+	BakeCorpse();
+
+	if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+	{
+		GameplayTimers->SetTimer(DeathTimer, this, &AEnemy::Disappear, DeathDelay);
 
-	GetWorldTimerManager().SetTimer(DeathTimer, this, &AEnemy::Disappear, DeathDelay);
+		// Fade-out of the corpse during the last CorpseFadeTime seconds
+		const float FadeTime = FMath::Min(CorpseFadeTime, DeathDelay);
+		if (CorpseMesh && FadeTime > 0.f && CorpseFadeParameter != NAME_None)
+		{
+			CorpseFadeStartTime = GetWorld()->GetTimeSeconds() + DeathDelay - FadeTime;
+			GameplayTimers->SetTimer(CorpseFadeTimer, this, &AEnemy::UpdateCorpseFade, 0.05f, true, DeathDelay - FadeTime);
+		}
+	}
+}
+
+// Called by DeathEnd(), only the poseable copy of the final pose is left until Disappear(), ActivateFromPool() undoes all of it
+void AEnemy::BakeCorpse()
+{
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->UnregisterEnemy(this);
+	}
+	if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+	{
+		GameplayTimers->ClearTimer(NavWalkingTimer);
+	}
+
+	// Dormant stops the movement, AI and mesh ticks
+	SetSignificance(EEnemySignificance::ES_Dormant);
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	SetActorEnableCollision(false);
+
+	// The controller is destroyed right away, a pooled enemy spawns a new one when it is reused
+	if (AIController)
+	{
+		AIController->StopMovement();
+	}
+	DetachFromControllerPendingDestroy();
+	AIController = nullptr;
+
+	// Final pose copied into a poseable mesh, it never ticks nor evaluates an animation and only skins the bones it was given once.
+	// Created on the first death, a pooled enemy reuses it
+	USkeletalMeshComponent* EnemyMesh = GetMesh();
+	if (CorpseMesh == nullptr)
+	{
+		CorpseMesh = NewObject<UPoseableMeshComponent>(this, TEXT("CorpseMesh"));
+		CorpseMesh->PrimaryComponentTick.bCanEverTick = false;
+		CorpseMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		CorpseMesh->SetCanEverAffectNavigation(false);
+		CorpseMesh->RegisterComponent();
+	}
+	CorpseMesh->SetSkeletalMesh(EnemyMesh->SkeletalMesh);
+	CorpseMesh->SetWorldTransform(EnemyMesh->GetComponentTransform());
+	for (int32 i = 0; i < EnemyMesh->GetNumMaterials(); ++i)
+	{
+		CorpseMesh->SetMaterial(i, EnemyMesh->GetMaterial(i)); // Original materials, the fade of the last death changed them
+	}
+	CorpseMesh->CopyPoseFromSkeletalComponent(EnemyMesh);
+	CorpseMesh->SetVisibility(true);
+
+	// The skeletal mesh is hidden and frozen, the hitbox and the capsule leave the scene until ActivateFromPool()
+	EnemyMesh->bPauseAnims = true;
+	EnemyMesh->bNoSkeletonUpdate = true;
+	EnemyMesh->SetVisibility(false);
+	Hitbox->UnregisterComponent();
+	GetCapsuleComponent()->UnregisterComponent();
+}
+
+// Called by CorpseFadeTimer during the last CorpseFadeTime seconds of DeathDelay
+void AEnemy::UpdateCorpseFade()
+{
+	const float FadeTime = FMath::Min(CorpseFadeTime, DeathDelay);
+	const float Alpha = FadeTime > 0.f ? FMath::Clamp(1.f - (GetWorld()->GetTimeSeconds() - CorpseFadeStartTime) / FadeTime, 0.f, 1.f) : 0.f;
+	if (CorpseMesh)
+	{
+		CorpseMesh->SetScalarParameterValueOnMaterials(CorpseFadeParameter, Alpha);
+	}
+
+	if (Alpha <= 0.f)
+	{
+		if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+		{
+			GameplayTimers->ClearTimer(CorpseFadeTimer);
+		}
+	}
 }
 
-// Called after enemy dies after a set time to destroy the actor
+// Called after enemy dies after a set time to destroy the actor, pooled enemies are parked instead
 void AEnemy::Disappear()
 {
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->UnregisterEnemy(this);
+	}
+
+	UEnemyPoolSubsystem* EnemyPool = UEnemyPoolSubsystem::Get(this);
+	if (EnemyPool && EnemyPool->ReleaseEnemy(this)) return;
+
 	Destroy();
 }
 
+// Called by UEnemyManagerSubsystem when the enemy is far away and never saw the player, the enemy is already dormant
+// (no movement, AI or mesh ticks), hibernation also turns off the collision and the skeleton update
+void AEnemy::Hibernate()
+{
+	bHibernating = true;
+	SetSignificance(EEnemySignificance::ES_Dormant);
+	if (AIController)
+	{
+		AIController->StopMovement();
+	}
+	GetCharacterMovement()->StopMovementImmediately();
+	SetActorEnableCollision(false);
+	GetMesh()->bNoSkeletonUpdate = true;
+}
+
+// Called by UEnemyManagerSubsystem when the player gets within the wake distance
+void AEnemy::WakeUp()
+{
+	bHibernating = false;
+	GetMesh()->bNoSkeletonUpdate = false;
+	SetActorEnableCollision(true);
+	SetSignificance(EEnemySignificance::ES_Full);
+}
+
+// Called by UEnemyPoolSubsystem::ReleaseEnemy()
+void AEnemy::ParkInPool()
+{
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->UnregisterEnemy(this);
+	}
+	if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+	{
+		GameplayTimers->ClearTimer(DeathTimer);
+		GameplayTimers->ClearTimer(CorpseFadeTimer);
+	}
+
+	// Dormant stops the movement, AI and mesh ticks
+	SetSignificance(EEnemySignificance::ES_Dormant);
+	if (AIController)
+	{
+		AIController->StopMovement();
+	}
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+// Called by UEnemyPoolSubsystem::AcquireEnemy(), resets everything Die() and DeathEnd() changed
+void AEnemy::ActivateFromPool(const FVector& Location, const FRotator& Rotation)
+{
+	// Components released by BakeCorpse() back in the scene before moving
+	if (!GetCapsuleComponent()->IsRegistered())
+	{
+		GetCapsuleComponent()->RegisterComponent();
+	}
+	if (!Hitbox->IsRegistered())
+	{
+		Hitbox->RegisterComponent();
+	}
+	if (CorpseMesh)
+	{
+		CorpseMesh->SetVisibility(false);
+	}
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	// Stats and combat state back to the values of a freshly spawned enemy
+	Health = MaxHealth;
+	bHasBeenAggroed = false;
+	bHibernating = false;
+	bAttacking = false;
+	bHasValidTarget = false;
+	bOverlappingCombatSphere = false;
+	CombatTarget = nullptr;
+	EnemyMovementStatus = EEnemyMovementStatus::EMS_Idle;
+
+	// Collision
+	SetActorEnableCollision(true);
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	Hitbox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// Animations, the death montage is stopped and the pose unpaused
+	USkeletalMeshComponent* EnemyMesh = GetMesh();
+	EnemyMesh->bPauseAnims = false;
+	EnemyMesh->bNoSkeletonUpdate = false;
+	EnemyMesh->SetVisibility(true);
+	if (UAnimInstance* AnimInstance = EnemyMesh->GetAnimInstance())
+	{
+		AnimInstance->Montage_Stop(0.f);
+	}
+
+	// Controller, a new one is spawned if the old one went away
+	if (AIController == nullptr || AIController->GetPawn() != this)
+	{
+		SpawnDefaultController();
+		AIController = Cast<AAIController>(GetController());
+	}
+
+	GetCharacterMovement()->SetDefaultMovementMode();
+	SetSignificance(EEnemySignificance::ES_Full);
+	SetActorHiddenInGame(false);
+
+	if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
+	{
+		EnemyManager->RegisterEnemy(this);
+	}
+}
+
 // Called from Blueprint, returns true if enemy is not dead
 bool AEnemy::Alive()
 {
 	return GetEnemyMovementStatus() != EEnemyMovementStatus::EMS_Dead;
 }
+
+// Called whenever the enemy changes its movement status
+void AEnemy::SetEnemyMovementStatus(EEnemyMovementStatus Status)
+{
+	EnemyMovementStatus = Status;
+	if (ManagerIndex != INDEX_NONE)
+	{
+		UEnemyManagerSubsystem::Get(this)->SetMovementStatus(ManagerIndex, Status);
+	}
+}
+
+// Called when the enemy starts or finishes an attack
+void AEnemy::SetAttacking(bool Attacking)
+{
+	bAttacking = Attacking;
+	if (ManagerIndex != INDEX_NONE)
+	{
+		UEnemyManagerSubsystem::Get(this)->SetFlag(ManagerIndex, EEnemyFlags::Attacking, Attacking);
+	}
+}
+
+// Called when the enemy gets or loses the player as a target
+void AEnemy::SetHasValidTarget(bool HasValidTarget)
+{
+	bHasValidTarget = HasValidTarget;
+	if (ManagerIndex != INDEX_NONE)
+	{
+		UEnemyManagerSubsystem::Get(this)->SetFlag(ManagerIndex, EEnemyFlags::HasValidTarget, HasValidTarget);
+	}
+}
+
+// Called when the player enters or exits the enemy combat range
+void AEnemy::SetOverlappingCombatSphere(bool Overlapping)
+{
+	bOverlappingCombatSphere = Overlapping;
+	if (ManagerIndex != INDEX_NONE)
+	{
+		UEnemyManagerSubsystem::Get(this)->SetFlag(ManagerIndex, EEnemyFlags::OverlappingCombatSphere, Overlapping);
+	}
+}
+
+// Called when the player enters or exits the enemy combat range
+void AEnemy::SetCombatTarget(AMainCharacter* Target)
+{
+	CombatTarget = Target;
+	if (ManagerIndex != INDEX_NONE)
+	{
+		UEnemyManagerSubsystem::Get(this)->SetCombatTarget(ManagerIndex, Target);
+	}
+}
+
+// Called by the enemy manager when the enemy moves to another significance tier
+void AEnemy::SetSignificance(EEnemySignificance NewSignificance)
+{
+	if (Significance == NewSignificance) return;
+	Significance = NewSignificance;
+
+	const bool bDormant = NewSignificance == EEnemySignificance::ES_Dormant;
+	const bool bThrottleAnims = NewSignificance >= EEnemySignificance::ES_AnimThrottled;
+	const float TickInterval = (NewSignificance == EEnemySignificance::ES_Full) ? 0.f : ReducedTickInterval;
+
+	// Movement runs at a lower rate when the enemy is far away and stops completely when dormant
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->SetComponentTickInterval(TickInterval);
+	Movement->SetComponentTickEnabled(!bDormant);
+
+	// Same for the AI, including the path following component of the controller
+	if (AIController)
+	{
+		AIController->SetActorTickInterval(TickInterval);
+		AIController->SetActorTickEnabled(!bDormant);
+		if (UPathFollowingComponent* PathFollowing = AIController->GetPathFollowingComponent())
+		{
+			PathFollowing->SetComponentTickInterval(TickInterval);
+			PathFollowing->SetComponentTickEnabled(!bDormant);
+		}
+	}
+
+	// Animations skip frames (update rate optimizations) and only tick while rendered, the mesh stops ticking when dormant
+	USkeletalMeshComponent* EnemyMesh = GetMesh();
+	EnemyMesh->bEnableUpdateRateOptimizations = bThrottleAnims;
+	EnemyMesh->VisibilityBasedAnimTickOption = bThrottleAnims ? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered : DefaultAnimTickOption;
+	EnemyMesh->SetComponentTickEnabled(!bDormant);
+}
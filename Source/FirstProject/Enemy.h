@@ -9,6 +9,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "GameplayTimerWheel.h"
 #include "Enemy.generated.h"
 
 /** Enum to determine the movement status of the enemy */
@@ -22,6 +24,26 @@ enum class EEnemyMovementStatus :uint8
 	EMS_MAX UMETA(DeplayName = "DefaulMAX")
 };
 
+/** Significance tier assigned by UEnemyManagerSubsystem, from the most to the least expensive to update */
+UENUM(BlueprintType)
+enum class EEnemySignificance : uint8
+{
+	ES_Full UMETA(DisplayName = "Full"),
+	ES_Reduced UMETA(DisplayName = "Reduced"),
+	ES_AnimThrottled UMETA(DisplayName = "AnimThrottled"),
+	ES_Dormant UMETA(DisplayName = "Dormant"),
+	ES_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
+/** Enum to determine how the enemy chases the player */
+UENUM(BlueprintType)
+enum class EEnemyNavigationMode : uint8
+{
+	ENM_MoveTo UMETA(DisplayName = "MoveTo"),
+	ENM_FlowField UMETA(DisplayName = "FlowField"),
+	ENM_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
 UCLASS()
 class FIRSTPROJECT_API AEnemy : public ACharacter
 {
@@ -34,13 +56,18 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement")
 	EEnemyMovementStatus EnemyMovementStatus;
 
-	/** Sphere that once the player overlaps the enemy will chase after */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "AI")
-	class USphereComponent* AgroSphere;
+	/** Distance to the player for the enemy to start chasing after it (checked by UEnemyManagerSubsystem) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI")
+	float AgroRadius;
 
-	/** Sphere that once the player overlaps the enemy will attack */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "AI")
-	USphereComponent* CombatSphere;
+	/** Distance to the player for the enemy to start attacking it (checked by UEnemyManagerSubsystem) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI")
+	float CombatRadius;
+
+	/** Extra distance the player has to move away before leaving the agro or combat range,
+	/* stops the enemy from switching between chasing and attacking when the player stands on the edge */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI")
+	float ProximityHysteresis;
 
 	/** AIController variable for reference */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "AI")
@@ -78,10 +105,7 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
 	class UAnimMontage* CombatMontage;
 
-	/** TimerHandle for enemy attacks */
-	FTimerHandle AttackTimer;
-
-	/** Player is Overlapping with enemy CombatSphere Y/N */
+	/** Player is inside the enemy combat range Y/N */
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "AI")
 	bool bOverlappingCombatSphere;
 
@@ -108,39 +132,129 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
 	TSubclassOf<UDamageType> DamageTypeClass;
 
-	/** TimerHandle for the Destroy() function */
-	FTimerHandle DeathTimer;
+	/** Attack in progress, the damage queue applies the damage of an attack once per target */
+	uint32 SwingId;
+
+	/** TimerHandle for the Destroy() function, set in the gameplay timer wheel */
+	FGameplayTimerHandle DeathTimer;
 
 	/** Value for the amount of time the Destroy() function will be delayed */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
 	float DeathDelay;
 
+	/** Poseable copy of the final pose shown instead of the skeletal mesh once the enemy is dead, created on the first death */
+	UPROPERTY()
+	class UPoseableMeshComponent* CorpseMesh;
+
+	/** Seconds at the end of DeathDelay during which the corpse fades out */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
+	float CorpseFadeTime;
+
+	/** Scalar parameter of the enemy materials driven from 1 to 0 by the fade-out, materials without it don't fade */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
+	FName CorpseFadeParameter;
+
+	/** TimerHandle for UpdateCorpseFade(), set in the gameplay timer wheel */
+	FGameplayTimerHandle CorpseFadeTimer;
+
+	/** Game time the fade-out starts at */
+	float CorpseFadeStartTime;
+
+	/** Index of the enemy inside the UEnemyManagerSubsystem arrays, INDEX_NONE when not registered */
+	int32 ManagerIndex;
+
+	/** Slot of the enemy in the nearest enemy index of the UEnemyManagerSubsystem, INDEX_NONE when out of combat range */
+	int32 NearestIndexSlot;
+
+	/** Index of the proxy record of the enemy in the UEnemyManagerSubsystem while hibernating, INDEX_NONE otherwise */
+	int32 HibernationIndex;
+
+	/** The enemy agroed the player at least once, only enemies that never did can hibernate */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Optimization")
+	bool bHasBeenAggroed;
+
+	/** The enemy is hibernating, no ticks, no collision and no animation until the player gets close */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Optimization")
+	bool bHibernating;
+
+	/** Current significance tier, lower tiers update the movement, AI and animations less often */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Optimization")
+	EEnemySignificance Significance;
+
+	/** Tick interval for the movement and the AIController when the enemy is not at full significance */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Optimization")
+	float ReducedTickInterval;
+
+	/** MoveTo runs a path query per enemy (shared through the path cache), FlowField follows the field the enemy manager
+	/* builds towards the player, cheaper for big packs. Can be overridden for every enemy with fp.EnemyNavigationMode */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "AI")
+	EEnemyNavigationMode NavigationMode;
+
+	/** Ground minions move in the NavWalking mode of the character movement (projected on the navmesh, no floor sweeps),
+	/* they go back to full walking when hit or airborne. Can be turned off for every enemy with fp.EnemyNavWalking 0 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Optimization")
+	bool bUseNavWalking;
+
+	/** Seconds of full walking after being hit or landing before the enemy goes back to NavWalking */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Optimization")
+	float NavWalkingResumeDelay;
+
+	/** TimerHandle for ResumeNavWalking(), set in the gameplay timer wheel */
+	FGameplayTimerHandle NavWalkingTimer;
+
+	/** Mesh anim tick option set in the Blueprint, restored when the enemy goes back to full significance */
+	EVisibilityBasedAnimTickOption DefaultAnimTickOption;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	// Called when the enemy is removed from the world
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Called when the character movement changes mode, used to go back to NavWalking after falling or being hit
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
 
+public:
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	/** Set and Get functions for EnemyStatus Enum */
-	FORCEINLINE void SetEnemyMovementStatus(EEnemyMovementStatus Status) { EnemyMovementStatus = Status; }
+	void SetEnemyMovementStatus(EEnemyMovementStatus Status);
 	FORCEINLINE EEnemyMovementStatus GetEnemyMovementStatus() { return EnemyMovementStatus; }
 
-	/** Enables Overlap with Enemy AgroSphere */
-	UFUNCTION()
-	virtual void AgroSphereOnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
-	UFUNCTION()
-	virtual void AgroSphereOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+	/** Setters for the combat state, they also update the enemy state stored in the UEnemyManagerSubsystem */
+	void SetAttacking(bool Attacking);
+	void SetHasValidTarget(bool HasValidTarget);
+	void SetOverlappingCombatSphere(bool Overlapping);
+	void SetCombatTarget(AMainCharacter* Target);
 
-	/** Enables Overlap with Enemy CombatSphere */
-	UFUNCTION()
-	virtual void CombatSphereOnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
-	UFUNCTION()
-	virtual void CombatSphereOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+	/** Called by UEnemyManagerSubsystem when the enemy changes significance tier, adjusts the tick rates of the enemy */
+	void SetSignificance(EEnemySignificance NewSignificance);
+
+	/** True when the enemy should move in NavWalking mode (bUseNavWalking and fp.EnemyNavWalking) */
+	bool UsesNavWalking() const;
+
+	/** False when NavWalking is turned off for every enemy with fp.EnemyNavWalking 0 */
+	static bool IsNavWalkingAllowed();
+
+	/** Puts the enemy in the movement mode UsesNavWalking() asks for, when it is alive and on the ground */
+	void ApplyNavWalking();
+
+	/** Switches the grounded enemy back to NavWalking, called by NavWalkingTimer */
+	void ResumeNavWalking();
+
+	/** Called by UEnemyManagerSubsystem when the enemy goes to / comes back from hibernation */
+	void Hibernate();
+	void WakeUp();
+
+	/** Called by UEnemyManagerSubsystem when the player enters (with the enemy able to see it) / exits the enemy AgroRadius */
+	virtual void AgroRangeBegin(class AMainCharacter* MainCharacter);
+	virtual void AgroRangeEnd(AMainCharacter* MainCharacter);
+
+	/** Called by UEnemyManagerSubsystem when the player enters/exits the enemy CombatRadius */
+	virtual void CombatRangeBegin(AMainCharacter* MainCharacter);
+	virtual void CombatRangeEnd(AMainCharacter* MainCharacter);
 
 	/** Enemy moves to the player */
 	UFUNCTION(BlueprintCallable)
@@ -152,19 +266,28 @@ public:
 	UFUNCTION()
 	void HitboxOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	/** Enable/Disable enemy hitbox */
+	/** Called by UCombatQuerySubsystem when the swept hitbox hits an actor */
+	void HitboxOnSweepHit(const FHitResult& Hit);
+
+	/** Particles, sound and damage when the enemy attack hits the player */
+	void HitMainCharacter(AMainCharacter* MainCharacter);
+
+	/** Enable/Disable enemy hitbox, swept between frames or with overlap events depending on fp.CombatQueries */
 	UFUNCTION(BlueprintCallable)
 	void ActivateHitbox();
 	UFUNCTION(BlueprintCallable)
 	void DeactivateHitbox();
 
-	/** Enter combat animation and stop enemy movement */
+	/** Enter combat animation and stop enemy movement, called by the combat director of the enemy manager */
 	void Attack();
 
 	/** Exit combat animation and return movement to the enemy */
 	UFUNCTION(BlueprintCallable)
 	void AttackEnd();
 
+	/** Queues the next attack against the target in the combat director, after a random time between AttackMinTime and AttackMaxTime */
+	void ScheduleAttack(AMainCharacter* Target);
+
 	/** Virtual Function inherited from AActor, returns a float with the value of the damage */
 	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
 
@@ -175,9 +298,22 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void DeathEnd();
 
-	/** Destroy the enemy from the world after it dies */
+	/** Copies the final pose of the dead enemy into CorpseMesh, hides the skeletal mesh and releases everything else
+	/* (controller, hitbox, capsule, movement, manager slot), so the corpse only costs its draw until Disappear() */
+	void BakeCorpse();
+
+	/** Fades the corpse out by setting CorpseFadeParameter on the materials of CorpseMesh */
+	void UpdateCorpseFade();
+
+	/** Destroy the enemy from the world after it dies, or park it in the enemy pool to be reused */
 	void Disappear();
 
+	/** Called by UEnemyPoolSubsystem, hides the dead enemy and stops everything it updates */
+	void ParkInPool();
+
+	/** Called by UEnemyPoolSubsystem, brings a parked enemy back to life at the location */
+	void ActivateFromPool(const FVector& Location, const FRotator& Rotation);
+
 	/** Checks if the enemy is alive for conditional checks in enemy functions */
 	UFUNCTION(BlueprintCallable)
 	bool Alive();
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyCombatDirector.h"
+#include "FirstProject.h"
+#include "Enemy.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Combat Director"), STAT_EnemyCombatDirector, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued Attacks"), STAT_QueuedAttacks, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attack Starts This Frame"), STAT_AttackStarts, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attacks Waiting For Token"), STAT_AttacksWaitingForToken, STATGROUP_Enemies);
+
+
+// Sets default values
+FEnemyCombatDirector::FEnemyCombatDirector()
+{
+	TokensPerTarget = 3;
+	MaxAttackStartsPerFrame = 2;
+	TokenRetryDelay = 0.25f;
+	NextTicket = 1;
+}
+
+// Called by AEnemy::CombatRangeBegin() and AEnemy::AttackEnd()
+void FEnemyCombatDirector::ScheduleAttack(AEnemy* Enemy, AActor* Target, double Time)
+{
+	if (Enemy == nullptr || Target == nullptr) return;
+
+	// The new ticket makes the attack the enemy had queued stale, it is skipped when popped
+	const uint32 Ticket = NextTicket++;
+	Tickets.Add(Enemy, Ticket);
+	Queue.HeapPush({ Enemy, Target, Time, Ticket });
+}
+
+// Called by AEnemy::CombatRangeEnd() and AEnemy::Die()
+void FEnemyCombatDirector::CancelAttack(AEnemy* Enemy)
+{
+	Tickets.Remove(Enemy);
+}
+
+// Called by AEnemy::AttackEnd() and AEnemy::Die()
+void FEnemyCombatDirector::ReleaseToken(AEnemy* Enemy)
+{
+	for (FTargetTokens& Entry : Targets)
+	{
+		Entry.Holders.RemoveSingleSwap(Enemy, false);
+	}
+}
+
+// Called every frame by UEnemyManagerSubsystem::Tick()
+void FEnemyCombatDirector::Tick(double Time)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyCombatDirector);
+
+	// Tokens of destroyed enemies and targets go back to the pool
+	for (int32 Index = Targets.Num() - 1; Index >= 0; --Index)
+	{
+		FTargetTokens& Entry = Targets[Index];
+		Entry.Holders.RemoveAllSwap([](const TWeakObjectPtr<AEnemy>& Holder) { return !Holder.IsValid(); }, false);
+		if (!Entry.Target.IsValid() || Entry.Holders.Num() == 0)
+		{
+			Targets.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	int32 NumStarts = 0;
+	int32 NumWaiting = 0;
+	TArray<FScheduledAttack, TInlineAllocator<16>> Retries;
+
+	while (Queue.Num() > 0 && Queue.HeapTop().Time <= Time && NumStarts < MaxAttackStartsPerFrame)
+	{
+		FScheduledAttack Attack;
+		Queue.HeapPop(Attack, false);
+
+		AEnemy* Enemy = Attack.Enemy.Get();
+		AActor* Target = Attack.Target.Get();
+		const uint32* Ticket = Tickets.Find(Attack.Enemy);
+		if (Enemy == nullptr || Target == nullptr || Ticket == nullptr || *Ticket != Attack.Ticket) continue; // Canceled
+
+		// No free token, the enemy keeps its place and tries again a bit later
+		FTargetTokens& Entry = FindOrAddTarget(Target);
+		if (Entry.Holders.Num() >= TokensPerTarget)
+		{
+			Attack.Time = Time + TokenRetryDelay;
+			Retries.Add(Attack);
+			++NumWaiting;
+			continue;
+		}
+
+		Tickets.Remove(Attack.Enemy);
+		Entry.Holders.Add(Enemy);
+		Enemy->Attack();
+		if (Enemy->bAttacking)
+		{
+			++NumStarts;
+		}
+		else
+		{
+			Entry.Holders.RemoveSingleSwap(Enemy, false); // The enemy couldn't attack (dead or no valid target)
+		}
+	}
+
+	// Pushed after the loop so an attack waiting for a token is not popped again on the same frame
+	for (const FScheduledAttack& Retry : Retries)
+	{
+		Queue.HeapPush(Retry);
+	}
+
+	// Dropping the canceled entries once they are most of the queue
+	if (Queue.Num() > 64 && Queue.Num() > Tickets.Num() * 2)
+	{
+		Queue.RemoveAllSwap([this](const FScheduledAttack& Attack)
+		{
+			const uint32* Ticket = Tickets.Find(Attack.Enemy);
+			return Ticket == nullptr || *Ticket != Attack.Ticket;
+		}, false);
+		Queue.Heapify();
+	}
+
+	SET_DWORD_STAT(STAT_QueuedAttacks, Tickets.Num());
+	SET_DWORD_STAT(STAT_AttackStarts, NumStarts);
+	SET_DWORD_STAT(STAT_AttacksWaitingForToken, NumWaiting);
+}
+
+// Called when the enemy manager is deinitialized
+void FEnemyCombatDirector::Reset()
+{
+	Queue.Empty();
+	Tickets.Empty();
+	Targets.Empty();
+}
+
+// Returns the token entry of the target
+FEnemyCombatDirector::FTargetTokens& FEnemyCombatDirector::FindOrAddTarget(AActor* Target)
+{
+	for (FTargetTokens& Entry : Targets)
+	{
+		if (Entry.Target.Get() == Target)
+		{
+			return Entry;
+		}
+	}
+
+	FTargetTokens& Entry = Targets.AddDefaulted_GetRef();
+	Entry.Target = Target;
+	return Entry;
+}
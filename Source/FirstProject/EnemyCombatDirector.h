@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Schedules the attacks of every enemy from one queue sorted by time, instead of one AttackTimer per enemy.
+ * Every target has a fixed number of attack tokens, an enemy needs a token to start an attack and gives it
+ * back when the attack ends, and only a few attacks can start on the same frame.
+ * Owned and ticked by the UEnemyManagerSubsystem.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AEnemy;
+
+class FIRSTPROJECT_API FEnemyCombatDirector
+{
+public:
+	FEnemyCombatDirector();
+
+	/** Queues an attack of the enemy against the target, replaces the attack the enemy already had queued
+	/* @param Time: world time in seconds when the enemy wants to attack */
+	void ScheduleAttack(AEnemy* Enemy, AActor* Target, double Time);
+
+	/** Removes the queued attack of the enemy, if any */
+	void CancelAttack(AEnemy* Enemy);
+
+	/** Gives back the token the enemy is holding, if any */
+	void ReleaseToken(AEnemy* Enemy);
+
+	/** Starts the attacks that are due and have a free token
+	/* @param Time: current world time in seconds */
+	void Tick(double Time);
+
+	/** Drops every queued attack and token */
+	void Reset();
+
+	/** Number of enemies that can attack the same target at once */
+	int32 TokensPerTarget;
+
+	/** Max attacks started in one frame */
+	int32 MaxAttackStartsPerFrame;
+
+	/** Seconds an enemy waits before trying again when its target has no free token */
+	float TokenRetryDelay;
+
+private:
+	/** Attack waiting in the queue */
+	struct FScheduledAttack
+	{
+		TWeakObjectPtr<AEnemy> Enemy;
+		TWeakObjectPtr<AActor> Target;
+		double Time;
+		uint32 Ticket;
+
+		/** Heap order, earliest attack first */
+		bool operator<(const FScheduledAttack& Other) const { return Time < Other.Time; }
+	};
+
+	/** Tokens of one target */
+	struct FTargetTokens
+	{
+		TWeakObjectPtr<AActor> Target;
+		TArray<TWeakObjectPtr<AEnemy>, TInlineAllocator<4>> Holders;
+	};
+
+	/** Binary heap of the queued attacks */
+	TArray<FScheduledAttack> Queue;
+
+	/** Ticket of the attack each enemy has queued, queue entries with an older ticket were canceled */
+	TMap<TWeakObjectPtr<AEnemy>, uint32> Tickets;
+
+	/** Tokens in use, one entry per target (usually only the main character) */
+	TArray<FTargetTokens> Targets;
+
+	uint32 NextTicket;
+
+	/** Returns the tokens of the target, creating the entry when needed */
+	FTargetTokens& FindOrAddTarget(AActor* Target);
+};
@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyFlowField.h"
+#include "FirstProject.h"
+#include "Async/Async.h"
+#include "NavigationSystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flow Field Sampling"), STAT_FlowFieldSampling, STATGROUP_Enemies);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Flow Field Build Time (ms, worker)"), STAT_FlowFieldBuildTime, STATGROUP_Enemies);
+
+
+// Sets default values
+FEnemyFlowField::FEnemyFlowField()
+{
+	GridSize = 64;
+	CellSize = 100.f;
+	UpdateInterval = 6;
+	SamplesPerFrame = 256;
+	GridOrigin = FVector::ZeroVector;
+	bHasGrid = false;
+	SampleCursor = 0;
+	FramesSinceBuild = 0;
+	DirectionsOrigin = FVector::ZeroVector;
+	LastBuildTimeMs = 0.f;
+}
+
+// Makes sure the worker thread is done before the field is destroyed
+FEnemyFlowField::~FEnemyFlowField()
+{
+	Reset();
+}
+
+// Called every frame by the enemy manager while enemies are chasing the player in flow field mode
+void FEnemyFlowField::Update(UWorld* World, const FVector& GoalLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FlowFieldSampling);
+
+	// Taking the result of the last build once the worker is done
+	if (PendingBuild.IsValid() && PendingBuild.IsReady())
+	{
+		FBuildResult Result = PendingBuild.Get();
+		PendingBuild = TFuture<FBuildResult>();
+		Directions = MoveTemp(Result.Directions);
+		DirectionsOrigin = Result.Origin;
+		LastBuildTimeMs = Result.BuildTimeMs;
+		SET_FLOAT_STAT(STAT_FlowFieldBuildTime, LastBuildTimeMs);
+	}
+
+	// Keeping the goal away from the borders of the grid
+	const FIntPoint GoalCell = ToCell(GridOrigin, GoalLocation);
+	const int32 Margin = GridSize / 4;
+	if (!bHasGrid || GoalCell.X < Margin || GoalCell.Y < Margin || GoalCell.X >= GridSize - Margin || GoalCell.Y >= GridSize - Margin)
+	{
+		Recenter(GoalLocation);
+	}
+
+	// Sampling the navmesh a few cells per frame
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	if (NavSys && SampleCursor < Cells.Num())
+	{
+		const FVector Extent(CellSize * 0.5f, CellSize * 0.5f, 250.f);
+		const int32 LastSample = FMath::Min(SampleCursor + SamplesPerFrame, Cells.Num());
+		for (; SampleCursor < LastSample; ++SampleCursor)
+		{
+			const FVector CellCenter = GridOrigin + FVector((SampleCursor % GridSize + 0.5f) * CellSize, (SampleCursor / GridSize + 0.5f) * CellSize, GoalLocation.Z);
+			FNavLocation NavLocation;
+			Cells[SampleCursor] = NavSys->ProjectPointToNavigation(CellCenter, NavLocation, Extent) ? Walkable : Blocked;
+		}
+	}
+
+	// Starting a new build every UpdateInterval frames, only one build runs at a time and only once every cell
+	// of the grid was sampled, until then the enemies keep the field built for the previous grid
+	++FramesSinceBuild;
+	if (FramesSinceBuild >= UpdateInterval && SampleCursor == Cells.Num() && !PendingBuild.IsValid())
+	{
+		FramesSinceBuild = 0;
+		const FIntPoint BuildGoalCell = ToCell(GridOrigin, GoalLocation);
+		PendingBuild = Async(EAsyncExecution::ThreadPool, [BuildCells = Cells, BuildGridSize = GridSize, BuildGoalCell, BuildOrigin = GridOrigin]()
+		{
+			return Build(BuildCells, BuildGridSize, BuildGoalCell, BuildOrigin);
+		});
+	}
+}
+
+// Called by the enemy manager for every enemy chasing the player in flow field mode
+bool FEnemyFlowField::SampleDirection(const FVector& Location, FVector& OutDirection) const
+{
+	if (Directions.Num() == 0) return false;
+
+	const FIntPoint Cell = ToCell(DirectionsOrigin, Location);
+	if (Cell.X == INDEX_NONE) return false;
+
+	const FVector2D& Direction = Directions[Cell.Y * GridSize + Cell.X];
+	if (Direction.IsZero()) return false;
+
+	OutDirection = FVector(Direction.X, Direction.Y, 0.f);
+	return true;
+}
+
+// Called when the enemy manager is deinitialized
+void FEnemyFlowField::Reset()
+{
+	if (PendingBuild.IsValid())
+	{
+		PendingBuild.Wait();
+		PendingBuild = TFuture<FBuildResult>();
+	}
+	Directions.Empty();
+	Cells.Empty();
+	bHasGrid = false;
+}
+
+// Called by Update() when the goal gets close to the border of the grid
+void FEnemyFlowField::Recenter(const FVector& GoalLocation)
+{
+	// Snapping the origin to the cell size so cells line up between recenters
+	const float HalfExtent = GridSize * CellSize * 0.5f;
+	GridOrigin.X = FMath::GridSnap(GoalLocation.X - HalfExtent, CellSize);
+	GridOrigin.Y = FMath::GridSnap(GoalLocation.Y - HalfExtent, CellSize);
+	GridOrigin.Z = 0.f;
+	bHasGrid = true;
+
+	Cells.Init(Unknown, GridSize * GridSize);
+	SampleCursor = 0;
+}
+
+// Converts a world location into grid coordinates
+FIntPoint FEnemyFlowField::ToCell(const FVector& Origin, const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt((Location.X - Origin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - Origin.Y) / CellSize);
+	if (X < 0 || Y < 0 || X >= GridSize || Y >= GridSize)
+	{
+		return FIntPoint(INDEX_NONE, INDEX_NONE);
+	}
+	return FIntPoint(X, Y);
+}
+
+// Runs on a worker thread, Dijkstra from the goal cell over the walkable cells (8 neighbours) and then
+// every cell points to its cheapest neighbour
+FEnemyFlowField::FBuildResult FEnemyFlowField::Build(TArray<uint8> InCells, int32 InGridSize, FIntPoint GoalCell, FVector Origin)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FBuildResult Result;
+	Result.Origin = Origin;
+	Result.Directions.Init(FVector2D::ZeroVector, InGridSize * InGridSize);
+
+	if (GoalCell.X == INDEX_NONE)
+	{
+		Result.BuildTimeMs = 0.f;
+		return Result;
+	}
+
+	static const int32 OffsetX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+	static const int32 OffsetY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+	static const float StepCost[8] = { 1.f, 1.f, 1.f, 1.f, UE_SQRT_2, UE_SQRT_2, UE_SQRT_2, UE_SQRT_2 };
+
+	auto IsWalkable = [&](int32 X, int32 Y)
+	{
+		return X >= 0 && Y >= 0 && X < InGridSize && Y < InGridSize && InCells[Y * InGridSize + X] == Walkable;
+	};
+
+	// Integration field
+	TArray<float> Costs;
+	Costs.Init(MAX_flt, InGridSize * InGridSize);
+
+	struct FOpenCell
+	{
+		float Cost;
+		int32 Index;
+		bool operator<(const FOpenCell& Other) const { return Cost < Other.Cost; }
+	};
+	TArray<FOpenCell> Open;
+	const int32 GoalIndex = GoalCell.Y * InGridSize + GoalCell.X;
+	Costs[GoalIndex] = 0.f;
+	Open.HeapPush({ 0.f, GoalIndex });
+
+	while (Open.Num() > 0)
+	{
+		FOpenCell Current;
+		Open.HeapPop(Current, false);
+		if (Current.Cost > Costs[Current.Index]) continue; // Stale entry
+
+		const int32 X = Current.Index % InGridSize;
+		const int32 Y = Current.Index / InGridSize;
+		for (int32 Neighbour = 0; Neighbour < 8; ++Neighbour)
+		{
+			const int32 NX = X + OffsetX[Neighbour];
+			const int32 NY = Y + OffsetY[Neighbour];
+			// Diagonals can't cut the corner of a blocked cell
+			if (!IsWalkable(NX, NY) || !IsWalkable(NX, Y) || !IsWalkable(X, NY)) continue;
+
+			const int32 NeighbourIndex = NY * InGridSize + NX;
+			const float NewCost = Current.Cost + StepCost[Neighbour];
+			if (NewCost < Costs[NeighbourIndex])
+			{
+				Costs[NeighbourIndex] = NewCost;
+				Open.HeapPush({ NewCost, NeighbourIndex });
+			}
+		}
+	}
+
+	// Direction field, pointing at the cheapest neighbour
+	for (int32 Index = 0; Index < Costs.Num(); ++Index)
+	{
+		if (Costs[Index] == MAX_flt || Index == GoalIndex) continue;
+
+		const int32 X = Index % InGridSize;
+		const int32 Y = Index / InGridSize;
+		float BestCost = Costs[Index];
+		FVector2D BestDirection = FVector2D::ZeroVector;
+		for (int32 Neighbour = 0; Neighbour < 8; ++Neighbour)
+		{
+			const int32 NX = X + OffsetX[Neighbour];
+			const int32 NY = Y + OffsetY[Neighbour];
+			if (!IsWalkable(NX, NY) || !IsWalkable(NX, Y) || !IsWalkable(X, NY)) continue;
+
+			const float NeighbourCost = Costs[NY * InGridSize + NX];
+			if (NeighbourCost < BestCost)
+			{
+				BestCost = NeighbourCost;
+				BestDirection = FVector2D(OffsetX[Neighbour], OffsetY[Neighbour]).GetSafeNormal();
+			}
+		}
+		Result.Directions[Index] = BestDirection;
+	}
+
+	Result.BuildTimeMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return Result;
+}
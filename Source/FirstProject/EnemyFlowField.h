@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Flow field towards the player over a coarse grid centered on it. The walkability of the cells is sampled
+ * from the navmesh on the game thread (a few cells per frame), and the integration field and the directions
+ * are built on a worker thread every few frames. Enemies in flow field mode just read the direction of their
+ * cell, so the cost of chasing the player stays the same no matter how many enemies are in the pack.
+ * Owned and updated by the UEnemyManagerSubsystem.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class FIRSTPROJECT_API FEnemyFlowField
+{
+public:
+	FEnemyFlowField();
+	~FEnemyFlowField();
+
+	/** Samples walkability and starts a new build on a worker thread when it is time to
+	/* @param GoalLocation: location the field flows towards (the player) */
+	void Update(UWorld* World, const FVector& GoalLocation);
+
+	/** Gets the direction to follow at Location, returns false when the location is outside of the field or unreachable */
+	bool SampleDirection(const FVector& Location, FVector& OutDirection) const;
+
+	/** Waits for the build in progress and clears the field */
+	void Reset();
+
+	/** Number of cells in every side of the grid */
+	int32 GridSize;
+
+	/** Size of a cell in world units */
+	float CellSize;
+
+	/** Frames between two builds of the field */
+	int32 UpdateInterval;
+
+	/** Navmesh walkability samples taken per frame */
+	int32 SamplesPerFrame;
+
+	/** Time in milliseconds the last build took on the worker thread */
+	FORCEINLINE float GetLastBuildTimeMs() const { return LastBuildTimeMs; }
+
+private:
+	/** Walkability of a cell */
+	enum ECellState : uint8
+	{
+		Unknown,
+		Walkable,
+		Blocked
+	};
+
+	/** Output of a build, computed on a worker thread */
+	struct FBuildResult
+	{
+		TArray<FVector2D> Directions;
+		FVector Origin;
+		float BuildTimeMs;
+	};
+
+	/** Builds the integration field from the goal cell and the direction of every cell (runs on a worker thread) */
+	static FBuildResult Build(TArray<uint8> InCells, int32 InGridSize, FIntPoint GoalCell, FVector Origin);
+
+	/** Moves the grid so the goal is in the middle, the walkability has to be sampled again */
+	void Recenter(const FVector& GoalLocation);
+
+	/** Cell coordinates of a location for a grid starting at Origin, INDEX_NONE coordinates when outside */
+	FIntPoint ToCell(const FVector& Origin, const FVector& Location) const;
+
+	/// Game thread state
+	//
+	/** Min corner of the grid being sampled */
+	FVector GridOrigin;
+	bool bHasGrid;
+
+	/** Walkability of every cell (ECellState), no build starts before every cell is sampled */
+	TArray<uint8> Cells;
+
+	/** Next cell to sample */
+	int32 SampleCursor;
+
+	/** Frames since the last build started */
+	int32 FramesSinceBuild;
+
+	/// Field in use
+	//
+	/** Direction of every cell towards the goal, zero when the goal can't be reached from the cell */
+	TArray<FVector2D> Directions;
+
+	/** Min corner of the grid the directions were built for */
+	FVector DirectionsOrigin;
+
+	/** Build running on the worker thread */
+	TFuture<FBuildResult> PendingBuild;
+
+	float LastBuildTimeMs;
+};
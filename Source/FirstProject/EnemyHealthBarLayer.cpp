@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyHealthBarLayer.h"
+#include "FirstProject.h"
+#include "Enemy.h"
+#include "Rendering/DrawElements.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Health Bars Update"), STAT_EnemyHealthBarsUpdate, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Health Bars"), STAT_EnemyHealthBars, STATGROUP_Enemies);
+
+
+// Sets default values
+UEnemyHealthBarLayer::UEnemyHealthBarLayer(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	MaxBars = 16;
+	BarSize = FVector2D(120.f, 10.f);
+	BarOffset = 85.f;
+	BackgroundColor = FLinearColor(0.f, 0.f, 0.f, 0.6f);
+	FillColor = FLinearColor(0.8f, 0.05f, 0.05f, 1.f);
+}
+
+// Called by AMainPlayerController every frame while enemies are engaged
+void UEnemyHealthBarLayer::UpdateBars(const TArray<AEnemy*>& Enemies, const FMatrix& ViewProjection)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyHealthBarsUpdate);
+
+	Bars.Reset();
+	for (int32 i = 0; i < Enemies.Num() && Bars.Num() < MaxBars; ++i)
+	{
+		const AEnemy* Enemy = Enemies[i];
+
+		// Same matrix for every enemy, one SIMD transform each
+		const FVector Location = Enemy->GetActorLocation();
+		FVector4 ClipPosition;
+		VectorStore(VectorTransformVector(VectorLoadFloat3_W1(&Location), &ViewProjection), &ClipPosition);
+		if (ClipPosition.W <= 0.f) continue; // Behind the camera
+
+		const float InvW = 1.f / ClipPosition.W;
+		const FVector2D ViewPosition(ClipPosition.X * InvW * 0.5f + 0.5f, 0.5f - ClipPosition.Y * InvW * 0.5f);
+		if (ViewPosition.X < 0.f || ViewPosition.X > 1.f || ViewPosition.Y < 0.f || ViewPosition.Y > 1.f) continue; // Outside the view
+
+		FBar& Bar = Bars.AddUninitialized_GetRef();
+		Bar.ViewPosition = ViewPosition;
+		Bar.HealthPercent = Enemy->MaxHealth > 0.f ? FMath::Clamp(Enemy->Health / Enemy->MaxHealth, 0.f, 1.f) : 0.f;
+	}
+	SET_DWORD_STAT(STAT_EnemyHealthBars, Bars.Num());
+
+	const ESlateVisibility NewVisibility = Bars.Num() > 0 ? ESlateVisibility::HitTestInvisible : ESlateVisibility::Collapsed;
+	if (GetVisibility() != NewVisibility)
+	{
+		SetVisibility(NewVisibility);
+	}
+}
+
+// Called when no enemy is engaged
+void UEnemyHealthBarLayer::ClearBars()
+{
+	if (Bars.Num() == 0 && GetVisibility() == ESlateVisibility::Collapsed) return;
+
+	Bars.Reset();
+	SET_DWORD_STAT(STAT_EnemyHealthBars, 0);
+	SetVisibility(ESlateVisibility::Collapsed);
+}
+
+// Called by Slate when the layer is visible
+int32 UEnemyHealthBarLayer::NativePaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	LayerId = Super::NativePaint(Args, AllottedGeometry, MyCullingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
+	if (Bars.Num() == 0) return LayerId;
+
+	// Every background in one layer and every fill in the next one, Slate batches the boxes of a layer together
+	const int32 BackgroundLayer = LayerId + 1;
+	const int32 FillLayer = LayerId + 2;
+	const FVector2D LocalSize = AllottedGeometry.GetLocalSize();
+	const FLinearColor Tint = InWidgetStyle.GetColorAndOpacityTint();
+	for (const FBar& Bar : Bars)
+	{
+		const FVector2D Position = Bar.ViewPosition * LocalSize - FVector2D(BarSize.X * 0.5f, BarOffset + BarSize.Y);
+
+		FSlateDrawElement::MakeBox(OutDrawElements, BackgroundLayer, AllottedGeometry.ToPaintGeometry(BarSize, FSlateLayoutTransform(Position)),
+			&BackgroundBrush, ESlateDrawEffect::None, BackgroundColor * Tint);
+
+		if (Bar.HealthPercent > 0.f)
+		{
+			FSlateDrawElement::MakeBox(OutDrawElements, FillLayer, AllottedGeometry.ToPaintGeometry(FVector2D(BarSize.X * Bar.HealthPercent, BarSize.Y), FSlateLayoutTransform(Position)),
+				&FillBrush, ESlateDrawEffect::None, FillColor * Tint);
+		}
+	}
+	return FillLayer;
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * One full screen widget that draws the health bars of every enemy engaged with the player. The enemies are
+ * projected to the screen in one batch with the view-projection matrix of the frame, and the bars are drawn as
+ * boxes in NativePaint from a reused array instead of one widget per bar, so Slate batches all the backgrounds
+ * and all the fills in two draws whatever the number of bars. The layer is collapsed when no bar is visible.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "EnemyHealthBarLayer.generated.h"
+
+class AEnemy;
+
+/**
+ *
+ */
+UCLASS(meta = (DisableNativeTick))
+class FIRSTPROJECT_API UEnemyHealthBarLayer : public UUserWidget
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UEnemyHealthBarLayer(const FObjectInitializer& ObjectInitializer);
+
+	/** Projects the enemies with the view-projection matrix and keeps their bars for the next paint
+	/* @param Enemies: engaged enemies, nearest first */
+	void UpdateBars(const TArray<AEnemy*>& Enemies, const FMatrix& ViewProjection);
+
+	/** Hides every bar */
+	void ClearBars();
+
+	/** Max bars drawn, the nearest enemies get them */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	int32 MaxBars;
+
+	/** Size of a bar in the screen */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	FVector2D BarSize;
+
+	/** Distance in the screen between the enemy location and the bottom of its bar */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	float BarOffset;
+
+	/** Brushes and colors of the bars, a brush without image is drawn as a plain box */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	FSlateBrush BackgroundBrush;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	FLinearColor BackgroundColor;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	FSlateBrush FillBrush;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthBars")
+	FLinearColor FillColor;
+
+protected:
+	/** Inherited from UUserWidget, draws the bars */
+	virtual int32 NativePaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+
+private:
+	struct FBar
+	{
+		/** Enemy location in the view, (0, 0) top left and (1, 1) bottom right */
+		FVector2D ViewPosition;
+		float HealthPercent;
+	};
+
+	/** Bars of the last update, the array keeps its memory between frames */
+	TArray<FBar> Bars;
+};
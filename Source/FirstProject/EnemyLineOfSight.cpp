@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyLineOfSight.h"
+#include "FirstProject.h"
+#include "Enemy.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Line Of Sight"), STAT_EnemyLineOfSight, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line Of Sight Traces"), STAT_LineOfSightTraces, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line Of Sight Blocked"), STAT_LineOfSightBlocked, STATGROUP_Enemies);
+
+
+// Sets default values
+FEnemyLineOfSight::FEnemyLineOfSight()
+{
+	TracesPerFrame = 16;
+}
+
+// Called by UEnemyManagerSubsystem::UpdateProximity() before the proximity pass
+void FEnemyLineOfSight::GatherResults(UWorld* World, TArray<TPair<AEnemy*, bool>>& OutResults)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyLineOfSight);
+
+	OutResults.Reset();
+	int32 NumBlocked = 0;
+	for (const FPendingTrace& Pending : PendingTraces)
+	{
+		AEnemy* Enemy = Pending.Enemy.Get();
+		FTraceDatum Datum;
+		if (Enemy == nullptr || !World->QueryTraceData(Pending.Handle, Datum)) continue; // Enemy gone or trace dropped, asked again later
+
+		// Only world static geometry is traced, so any hit means a wall between the enemy and the player
+		const bool bBlocked = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit;
+		OutResults.Add(TPair<AEnemy*, bool>(Enemy, !bBlocked));
+		if (bBlocked)
+		{
+			++NumBlocked;
+		}
+	}
+	PendingTraces.Reset();
+
+	SET_DWORD_STAT(STAT_LineOfSightBlocked, NumBlocked);
+}
+
+// Called by UEnemyManagerSubsystem::UpdateProximity() after the proximity pass
+void FEnemyLineOfSight::SubmitTraces(UWorld* World, AActor* Target, const TArray<AEnemy*>& Enemies)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyLineOfSight);
+
+	const FVector TargetLocation = Target->GetActorLocation();
+	const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+
+	const int32 NumTraces = FMath::Min(Enemies.Num(), TracesPerFrame);
+	for (int32 i = 0; i < NumTraces; ++i)
+	{
+		AEnemy* Enemy = Enemies[i];
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(EnemyLineOfSight), false, Enemy);
+		Params.AddIgnoredActor(Target);
+
+		const FVector EyeLocation = Enemy->GetActorLocation() + FVector(0.f, 0.f, Enemy->BaseEyeHeight);
+		FPendingTrace& Pending = PendingTraces.AddDefaulted_GetRef();
+		Pending.Handle = World->AsyncLineTraceByObjectType(EAsyncTraceType::Single, EyeLocation, TargetLocation, ObjectParams, Params);
+		Pending.Enemy = Enemy;
+	}
+
+	SET_DWORD_STAT(STAT_LineOfSightTraces, NumTraces);
+}
+
+// Called when the enemy manager is deinitialized
+void FEnemyLineOfSight::Reset()
+{
+	PendingTraces.Empty();
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Line of sight checks from the enemies to the player, submitted as async traces in one batch per frame
+ * and read back on the next frame, so the enemies don't agro the player through walls and no enemy
+ * pays for a synchronous trace. Owned by the UEnemyManagerSubsystem, which picks the enemies to check.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+
+class AEnemy;
+
+class FIRSTPROJECT_API FEnemyLineOfSight
+{
+public:
+	FEnemyLineOfSight();
+
+	/** Reads the traces submitted on the previous frame
+	/* @param OutResults: enemy and whether it can see the target, only for the traces that finished */
+	void GatherResults(UWorld* World, TArray<TPair<AEnemy*, bool>>& OutResults);
+
+	/** Starts one async trace from the eyes of every enemy to the target */
+	void SubmitTraces(UWorld* World, AActor* Target, const TArray<AEnemy*>& Enemies);
+
+	/** Forgets the traces in flight */
+	void Reset();
+
+	/** Max traces submitted per frame */
+	int32 TracesPerFrame;
+
+private:
+	/** Trace in flight */
+	struct FPendingTrace
+	{
+		FTraceHandle Handle;
+		TWeakObjectPtr<AEnemy> Enemy;
+	};
+
+	TArray<FPendingTrace> PendingTraces;
+};
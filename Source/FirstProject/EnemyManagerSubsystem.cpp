@@ -0,0 +1,901 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyManagerSubsystem.h"
+#include "FirstProject.h"
+#include "Engine/World.h"
+#include "MainCharacter.h"
+#include "Kismet/GameplayStatics.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/Engine.h"
+#include "DrawDebugHelpers.h"
+#include "HAL/IConsoleManager.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Manager Update"), STAT_EnemyManagerUpdate, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Registered Enemies"), STAT_RegisteredEnemies, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attacking Enemies"), STAT_AttackingEnemies, STATGROUP_Enemies);
+DECLARE_CYCLE_STAT(TEXT("Enemy Proximity"), STAT_EnemyProximity, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proximity Events"), STAT_ProximityEvents, STATGROUP_Enemies);
+DECLARE_CYCLE_STAT(TEXT("Enemy Significance"), STAT_EnemySignificance, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Full"), STAT_SignificanceFull, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Reduced"), STAT_SignificanceReduced, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance AnimThrottled"), STAT_SignificanceAnimThrottled, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Dormant"), STAT_SignificanceDormant, STATGROUP_Enemies);
+DECLARE_CYCLE_STAT(TEXT("Enemy Flow Field"), STAT_EnemyFlowField, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flow Field Followers"), STAT_FlowFieldFollowers, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hibernating Enemies"), STAT_HibernatingEnemies, STATGROUP_Enemies);
+DECLARE_MEMORY_STAT(TEXT("Hibernation Manager Array Memory Saved"), STAT_HibernationMemorySaved, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hibernation Component Ticks Disabled"), STAT_HibernationTicksDisabled, STATGROUP_Enemies);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hibernation Collision Primitives Disabled"), STAT_HibernationCollisionsDisabled, STATGROUP_Enemies);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Manager Per-Enemy Loop Time Per Active Enemy (us)"), STAT_ManagerTimePerEnemy, STATGROUP_Enemies);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Hibernation Per-Enemy Loop Time Saved (us)"), STAT_HibernationTimeSaved, STATGROUP_Enemies);
+
+/** Debug view for the significance tiers, enabled with the console command "fp.ShowEnemySignificance 1" */
+static TAutoConsoleVariable<int32> CVarShowEnemySignificance(
+	TEXT("fp.ShowEnemySignificance"),
+	0,
+	TEXT("Shows the number of enemies in every significance tier on screen.\n")
+	TEXT("0: off, 1: tier counts, 2: tier counts and a colored point over every enemy"));
+
+/** Override of AEnemy::NavigationMode to compare both modes in the same map, read when an enemy starts chasing */
+static TAutoConsoleVariable<int32> CVarEnemyNavigationMode(
+	TEXT("fp.EnemyNavigationMode"),
+	0,
+	TEXT("How the enemies chase the player.\n")
+	TEXT("0: per enemy class (AEnemy::NavigationMode), 1: every enemy uses MoveTo, 2: every enemy uses the flow field"));
+
+/** Line of sight check before the enemies agro the player, can be turned off to get the old agro by distance only */
+static TAutoConsoleVariable<int32> CVarEnemyLineOfSight(
+	TEXT("fp.EnemyLineOfSight"),
+	1,
+	TEXT("0: enemies agro the player as soon as it is inside their agro radius, 1: they also need to see the player"));
+
+#if !UE_BUILD_SHIPPING
+/** Ticks the character movement of every living enemy on the ground in Walking and then in NavWalking mode, prints the
+/* movement time per enemy of both modes and puts the enemies back */
+static void BenchmarkEnemyMovement(const TArray<FString>& Args, UWorld* World)
+{
+	UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(World);
+	if (EnemyManager == nullptr) return;
+	int32 NumFrames = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0;
+	if (NumFrames <= 0) NumFrames = 60;
+
+	// Living enemies on the ground, with the state they get back after every run
+	struct FEnemyState
+	{
+		AEnemy* Enemy;
+		FVector Location;
+		FRotator Rotation;
+		FVector Velocity;
+		EMovementMode MovementMode;
+	};
+	TArray<FEnemyState> States;
+	int32 NumMoving = 0;
+	for (int32 Index = 0; Index < EnemyManager->GetNumEnemies(); ++Index)
+	{
+		AEnemy* Enemy = EnemyManager->GetEnemy(Index);
+		UCharacterMovementComponent* Movement = Enemy->GetCharacterMovement();
+		if (!Enemy->Alive() || !Movement->IsMovingOnGround()) continue;
+
+		States.Add({ Enemy, Enemy->GetActorLocation(), Enemy->GetActorRotation(), Movement->Velocity, Movement->MovementMode });
+		if (!Movement->Velocity.IsNearlyZero())
+		{
+			++NumMoving;
+		}
+	}
+	if (States.Num() == 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("fp.BenchmarkEnemyMovement: no living enemy on the ground"));
+		return;
+	}
+
+	// Every run starts from the same state, returns the average movement time per enemy and frame in microseconds
+	const float DeltaTime = 1.f / 60.f;
+	int32 NumInMode = 0;
+	auto RunMode = [&](EMovementMode Mode)
+	{
+		for (const FEnemyState& State : States)
+		{
+			State.Enemy->GetCharacterMovement()->SetMovementMode(Mode);
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (const FEnemyState& State : States)
+			{
+				UCharacterMovementComponent* Movement = State.Enemy->GetCharacterMovement();
+				Movement->TickComponent(DeltaTime, LEVELTICK_All, &Movement->PrimaryComponentTick);
+			}
+		}
+		const double Microseconds = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+
+		// Enemies that fell back to another mode (no navmesh under them, walked off a ledge)
+		NumInMode = 0;
+		for (const FEnemyState& State : States)
+		{
+			UCharacterMovementComponent* Movement = State.Enemy->GetCharacterMovement();
+			if (Movement->MovementMode == Mode)
+			{
+				++NumInMode;
+			}
+			State.Enemy->SetActorLocationAndRotation(State.Location, State.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+			Movement->Velocity = State.Velocity;
+		}
+		return Microseconds / (NumFrames * States.Num());
+	};
+
+	const double WalkingUs = RunMode(MOVE_Walking);
+	const int32 NumWalking = NumInMode;
+	const double NavWalkingUs = RunMode(MOVE_NavWalking);
+	const int32 NumNavWalking = NumInMode;
+
+	for (const FEnemyState& State : States)
+	{
+		State.Enemy->GetCharacterMovement()->SetMovementMode(State.MovementMode);
+	}
+
+	const FString WalkingResult = FString::Printf(TEXT("Walking (%d enemies, %d moving, %d frames): %.2f us per enemy, %d still walking at the end"),
+		States.Num(), NumMoving, NumFrames, WalkingUs, NumWalking);
+	const FString NavWalkingResult = FString::Printf(TEXT("NavWalking (%d enemies, %d moving, %d frames): %.2f us per enemy, %d still nav walking at the end"),
+		States.Num(), NumMoving, NumFrames, NavWalkingUs, NumNavWalking);
+	UE_LOG(LogTemp, Log, TEXT("%s"), *WalkingResult);
+	UE_LOG(LogTemp, Log, TEXT("%s"), *NavWalkingResult);
+	if (GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Cyan, WalkingResult);
+		GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Cyan, NavWalkingResult);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkEnemyMovementCommand(
+	TEXT("fp.BenchmarkEnemyMovement"),
+	TEXT("Ticks the character movement of every living enemy on the ground for <NumFrames> frames (60 by default) in Walking\n")
+	TEXT("and then in NavWalking mode, prints the movement time per enemy of both modes"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkEnemyMovement));
+#endif
+
+
+
+// Sets default values
+UEnemyManagerSubsystem::UEnemyManagerSubsystem()
+{
+	MaxProximityRange = 0.f;
+	ProximityStamp = 0;
+	UpdateTimePerEnemy = 0.f;
+	HibernationTicksDisabled = 0;
+	HibernationCollisionsDisabled = 0;
+	bNavWalkingAllowed = true;
+
+	// Significance defaults, can be overridden in DefaultGame.ini
+	ReducedSignificanceDistance = 1500.f;
+	AnimThrottledSignificanceDistance = 3000.f;
+	DormantSignificanceDistance = 6000.f;
+	OffscreenDistanceScale = 2.f;
+	SignificanceHysteresis = 0.15f;
+
+	// Hibernation defaults, can be overridden in DefaultGame.ini
+	HibernationDistance = 8000.f;
+	WakeDistance = 7000.f;
+
+	// Path defaults, can be overridden in DefaultGame.ini
+	PathRepathDistance = 75.f;
+	PathJoinDistance = 300.f;
+
+	// Flow field defaults, can be overridden in DefaultGame.ini
+	FlowFieldGridSize = 64;
+	FlowFieldCellSize = 100.f;
+	FlowFieldUpdateFrames = 6;
+	FlowFieldSamplesPerFrame = 256;
+
+	// Combat director defaults, can be overridden in DefaultGame.ini
+	AttackTokensPerTarget = 3;
+	MaxAttackStartsPerFrame = 2;
+	AttackTokenRetryDelay = 0.25f;
+
+	// Line of sight default, can be overridden in DefaultGame.ini
+	LineOfSightTracesPerFrame = 16;
+	FMemory::Memzero(TierCounts);
+}
+
+// Returns the manager of the world the object lives in
+UEnemyManagerSubsystem* UEnemyManagerSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UEnemyManagerSubsystem>() : nullptr;
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UEnemyManagerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the subsystem is created for the world
+void UEnemyManagerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PathService.RepathDistance = PathRepathDistance;
+	PathService.JoinDistance = PathJoinDistance;
+
+	FlowField.GridSize = FMath::Max(FlowFieldGridSize, 8);
+	FlowField.CellSize = FMath::Max(FlowFieldCellSize, 10.f);
+	FlowField.UpdateInterval = FMath::Max(FlowFieldUpdateFrames, 1);
+	FlowField.SamplesPerFrame = FMath::Max(FlowFieldSamplesPerFrame, 1);
+
+	CombatDirector.TokensPerTarget = FMath::Max(AttackTokensPerTarget, 1);
+	CombatDirector.MaxAttackStartsPerFrame = FMath::Max(MaxAttackStartsPerFrame, 1);
+	CombatDirector.TokenRetryDelay = AttackTokenRetryDelay;
+
+	LineOfSight.TracesPerFrame = FMath::Max(LineOfSightTracesPerFrame, 1);
+
+	bNavWalkingAllowed = AEnemy::IsNavWalkingAllowed();
+}
+
+// Called when the world is torn down
+void UEnemyManagerSubsystem::Deinitialize()
+{
+	Enemies.Empty();
+	CombatTargets.Empty();
+	Locations.Empty();
+	MovementStatuses.Empty();
+	EnemyFlags.Empty();
+	ProximityRanges.Empty();
+	ProximityStamps.Empty();
+	Significances.Empty();
+	LineOfSightStamps.Empty();
+	LineOfSightCandidates.Empty();
+	HibernatingEnemies.Empty();
+	HibernatingLocations.Empty();
+	HibernatingSavings.Empty();
+	HibernationTicksDisabled = 0;
+	HibernationCollisionsDisabled = 0;
+	HibernationCandidates.Empty();
+	EnemiesInAgroRange.Empty();
+	NearestIndex.Reset();
+	PendingProximityEvents.Empty();
+	PathService.Reset();
+	FlowField.Reset();
+	CombatDirector.Reset();
+	LineOfSight.Reset();
+
+	Super::Deinitialize();
+}
+
+// Only tick for the real subsystem instance and while there are enemies to update
+bool UEnemyManagerSubsystem::IsTickable() const
+{
+	return !IsTemplate() && (Enemies.Num() > 0 || HibernatingEnemies.Num() > 0);
+}
+
+// Stat used by the engine to time the tickable object
+TStatId UEnemyManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyManagerSubsystem, STATGROUP_Tickables);
+}
+
+// Called every frame, updates every registered enemy in a single pass over the arrays
+void UEnemyManagerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyManagerUpdate);
+
+	// Waking up the hibernating enemies first so they are part of this pass
+	AMainCharacter* MainCharacter = Cast<AMainCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+	UpdateHibernation(MainCharacter);
+
+	// fp.EnemyNavWalking changed, every enemy switches mode now so both modes can be compared on the same enemies
+	const bool bAllowed = AEnemy::IsNavWalkingAllowed();
+	if (bAllowed != bNavWalkingAllowed)
+	{
+		bNavWalkingAllowed = bAllowed;
+		for (AEnemy* Enemy : Enemies)
+		{
+			Enemy->ApplyNavWalking();
+		}
+		for (AEnemy* Enemy : HibernatingEnemies)
+		{
+			Enemy->ApplyNavWalking();
+		}
+	}
+
+	const int32 NumEnemies = Enemies.Num();
+	int32 NumAttacking = 0;
+
+	// Time of the passes that visit every registered enemy, what a hibernating enemy doesn't cost
+	double PerEnemyTime = 0.0;
+	double PassStartTime = FPlatformTime::Seconds();
+
+	for (int32 Index = 0; Index < NumEnemies; ++Index)
+	{
+		// Refreshing the cached location so the other systems don't have to touch the actor
+		Locations[Index] = Enemies[Index]->GetActorLocation();
+
+		if (EnemyFlags[Index] & EEnemyFlags::Attacking)
+		{
+			++NumAttacking;
+		}
+	}
+	PerEnemyTime += FPlatformTime::Seconds() - PassStartTime;
+
+	// Raising the agro/combat range events with the fresh locations
+	if (MainCharacter)
+	{
+		UpdateProximity(MainCharacter);
+	}
+
+	// Repathing the enemies chasing a goal that moved too far from their shared path
+	PathService.Tick(DeltaTime);
+
+	// Moving the chasing enemies in flow field mode
+	UpdateFlowField(MainCharacter);
+
+	// Starting the enemy attacks that are due, a few per frame and only with a free attack token
+	CombatDirector.Tick(GetWorld()->GetTimeSeconds());
+
+	// Assigning the significance tiers after the proximity events so newly engaged enemies are at full rate
+	PassStartTime = FPlatformTime::Seconds();
+	UpdateSignificance(MainCharacter);
+	PerEnemyTime += FPlatformTime::Seconds() - PassStartTime;
+
+	SET_DWORD_STAT(STAT_RegisteredEnemies, NumEnemies);
+	SET_DWORD_STAT(STAT_AttackingEnemies, NumAttacking);
+
+	// What the hibernating enemies save: the per-enemy passes of the manager (measured on the active enemies), the manager
+	// arrays they left for a proxy record, and the component ticks and collision primitives counted when they went to sleep
+	if (NumEnemies > 0)
+	{
+		UpdateTimePerEnemy = (float)(PerEnemyTime * 1000000.0 / NumEnemies);
+	}
+	const int32 NumHibernating = HibernatingEnemies.Num();
+	const int32 ProxyBytes = sizeof(AEnemy*) + sizeof(FVector) + sizeof(FHibernationSavings);
+	SET_DWORD_STAT(STAT_HibernatingEnemies, NumHibernating);
+	SET_MEMORY_STAT(STAT_HibernationMemorySaved, NumHibernating * (GetBytesPerRegisteredEnemy() - ProxyBytes));
+	SET_DWORD_STAT(STAT_HibernationTicksDisabled, HibernationTicksDisabled);
+	SET_DWORD_STAT(STAT_HibernationCollisionsDisabled, HibernationCollisionsDisabled);
+	SET_FLOAT_STAT(STAT_ManagerTimePerEnemy, UpdateTimePerEnemy);
+	SET_FLOAT_STAT(STAT_HibernationTimeSaved, UpdateTimePerEnemy * NumHibernating);
+}
+
+// Called at the start of Tick(), the proxies are only a location check, hibernating enemies cost nothing else
+void UEnemyManagerSubsystem::UpdateHibernation(AMainCharacter* MainCharacter)
+{
+	if (MainCharacter == nullptr || HibernatingEnemies.Num() == 0) return;
+
+	const FVector PlayerLocation = MainCharacter->GetActorLocation();
+	const float WakeDistanceSquared = FMath::Square(WakeDistance);
+	for (int32 HibernationIndex = HibernatingEnemies.Num() - 1; HibernationIndex >= 0; --HibernationIndex)
+	{
+		if (FVector::DistSquared(HibernatingLocations[HibernationIndex], PlayerLocation) > WakeDistanceSquared) continue;
+
+		AEnemy* Enemy = HibernatingEnemies[HibernationIndex];
+		RemoveHibernatingAtSwap(HibernationIndex);
+		Enemy->WakeUp();
+		RegisterEnemy(Enemy);
+	}
+}
+
+// Called at the end of UpdateSignificance() for the picked enemies
+void UEnemyManagerSubsystem::HibernateEnemy(int32 Index)
+{
+	AEnemy* Enemy = Enemies[Index];
+	const FVector Location = Locations[Index];
+	UnregisterEnemy(Enemy);
+
+	Enemy->HibernationIndex = HibernatingEnemies.Add(Enemy);
+	HibernatingLocations.Add(Location);
+	Enemy->Hibernate();
+
+	// Counted from the state of the components once they are asleep
+	FHibernationSavings& Savings = HibernatingSavings.AddZeroed_GetRef();
+	CountHibernationSavings(Enemy, Savings);
+	HibernationTicksDisabled += Savings.TicksDisabled;
+	HibernationCollisionsDisabled += Savings.CollisionsDisabled;
+}
+
+// Called by HibernateEnemy()
+void UEnemyManagerSubsystem::CountHibernationSavings(AEnemy* Enemy, FHibernationSavings& OutSavings)
+{
+	auto CountComponents = [&OutSavings](AActor* Actor, bool bCountCollision)
+	{
+		TInlineComponentArray<UActorComponent*> Components(Actor);
+		for (UActorComponent* Component : Components)
+		{
+			if (Component->PrimaryComponentTick.bCanEverTick && !Component->IsComponentTickEnabled())
+			{
+				++OutSavings.TicksDisabled;
+			}
+
+			// Collision set on the component but turned off for the whole actor
+			UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component);
+			if (bCountCollision && Primitive && Primitive->IsRegistered() && Primitive->BodyInstance.GetCollisionEnabled(false) != ECollisionEnabled::NoCollision)
+			{
+				++OutSavings.CollisionsDisabled;
+			}
+		}
+	};
+
+	CountComponents(Enemy, !Enemy->GetActorEnableCollision());
+	if (AController* Controller = Enemy->GetController())
+	{
+		if (Controller->PrimaryActorTick.bCanEverTick && !Controller->IsActorTickEnabled())
+		{
+			++OutSavings.TicksDisabled;
+		}
+		CountComponents(Controller, false);
+	}
+}
+
+// Removes one proxy record, the last one is moved into the empty slot
+void UEnemyManagerSubsystem::RemoveHibernatingAtSwap(int32 HibernationIndex)
+{
+	HibernatingEnemies[HibernationIndex]->HibernationIndex = INDEX_NONE;
+	HibernationTicksDisabled -= HibernatingSavings[HibernationIndex].TicksDisabled;
+	HibernationCollisionsDisabled -= HibernatingSavings[HibernationIndex].CollisionsDisabled;
+	HibernatingEnemies.RemoveAtSwap(HibernationIndex, 1, false);
+	HibernatingLocations.RemoveAtSwap(HibernationIndex, 1, false);
+	HibernatingSavings.RemoveAtSwap(HibernationIndex, 1, false);
+
+	if (HibernatingEnemies.IsValidIndex(HibernationIndex))
+	{
+		HibernatingEnemies[HibernationIndex]->HibernationIndex = HibernationIndex; // Fixing the index of the proxy that was moved
+	}
+}
+
+// Size of one element of every SoA array
+int32 UEnemyManagerSubsystem::GetBytesPerRegisteredEnemy()
+{
+	return sizeof(AEnemy*) + sizeof(AMainCharacter*) + sizeof(FVector) + sizeof(EEnemyMovementStatus) + sizeof(uint8) +
+		sizeof(FEnemyProximityRanges) + sizeof(uint32) + sizeof(EEnemySignificance) + sizeof(uint32);
+}
+
+// Called every frame from Tick(), replaces the overlap events of the old AgroSphere and CombatSphere components
+void UEnemyManagerSubsystem::UpdateProximity(AMainCharacter* MainCharacter)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyProximity);
+
+	++ProximityStamp;
+	ProximityGrid.Rebuild(Locations);
+
+	// Results of the traces submitted last frame, used by this pass
+	ApplyLineOfSightResults();
+	LineOfSightCandidates.Reset();
+	const bool bNeedLineOfSight = CVarEnemyLineOfSight.GetValueOnGameThread() != 0;
+
+	// The spheres used to overlap the player capsule, so the capsule radius is added to the distances
+	const FVector PlayerLocation = MainCharacter->GetActorLocation();
+	const float PlayerRadius = MainCharacter->GetCapsuleComponent()->GetScaledCapsuleRadius();
+
+	// Enemies close enough to the player to be inside (or about to exit) one of their ranges
+	ProximityGrid.ForEachInRadius(PlayerLocation, MaxProximityRange + PlayerRadius, [&](int32 Index, float DistanceSquared)
+	{
+		ProximityStamps[Index] = ProximityStamp;
+
+		// Dead enemies exit every range, just like disabling the collision of the spheres used to do
+		if (MovementStatuses[Index] == EEnemyMovementStatus::EMS_Dead)
+		{
+			UpdateProximityState(Index, false, false);
+			return;
+		}
+
+		const FEnemyProximityRanges& Ranges = ProximityRanges[Index];
+		const float Distance = FMath::Sqrt(DistanceSquared) - PlayerRadius;
+
+		// Hysteresis, enter at the radius and only exit once past the bigger exit distance
+		const bool bWasInAgroRange = (EnemyFlags[Index] & EEnemyFlags::InAgroRange) != 0;
+		const bool bWasInCombatRange = (EnemyFlags[Index] & EEnemyFlags::InCombatRange) != 0;
+		bool bInAgroRange = Distance <= (bWasInAgroRange ? Ranges.AgroExit : Ranges.AgroEnter);
+		const bool bInCombatRange = Distance <= (bWasInCombatRange ? Ranges.CombatExit : Ranges.CombatEnter);
+
+		// Line of sight, only needed to start chasing, an enemy already chasing keeps going until the player gets away
+		if (bInAgroRange && !bWasInAgroRange && bNeedLineOfSight && !(EnemyFlags[Index] & EEnemyFlags::HasLineOfSight))
+		{
+			LineOfSightCandidates.Add(Index);
+			bInAgroRange = false;
+		}
+		else if (!bInAgroRange)
+		{
+			SetFlag(Index, EEnemyFlags::HasLineOfSight, false); // Too far, the result would be outdated when the enemy gets close again
+		}
+
+		UpdateProximityState(Index, bInAgroRange, bInAgroRange && bInCombatRange);
+		if (bInAgroRange && bInCombatRange)
+		{
+			NearestIndex.Update(Enemies[Index], DistanceSquared);
+		}
+	});
+
+	// Enemies in range that the query didn't find are now too far from the player
+	for (int32 i = EnemiesInAgroRange.Num() - 1; i >= 0; --i)
+	{
+		const int32 Index = EnemiesInAgroRange[i]->ManagerIndex;
+		if (ProximityStamps[Index] != ProximityStamp)
+		{
+			SetFlag(Index, EEnemyFlags::HasLineOfSight, false); // Needs a new trace before it can agro again
+			UpdateProximityState(Index, false, false);
+		}
+	}
+
+	// Traces for the enemies that are close enough but didn't see the player yet, read back next frame
+	SubmitLineOfSightTraces(MainCharacter);
+
+	// Raising the events after the pass so the enemies can safely query the manager
+	SET_DWORD_STAT(STAT_ProximityEvents, PendingProximityEvents.Num());
+	for (const FPendingProximityEvent& Pending : PendingProximityEvents)
+	{
+		switch (Pending.Event)
+		{
+		case EProximityEvent::AgroBegin:
+			Pending.Enemy->AgroRangeBegin(MainCharacter);
+			break;
+		case EProximityEvent::AgroEnd:
+			Pending.Enemy->AgroRangeEnd(MainCharacter);
+			break;
+		case EProximityEvent::CombatBegin:
+			Pending.Enemy->CombatRangeBegin(MainCharacter);
+			break;
+		case EProximityEvent::CombatEnd:
+			Pending.Enemy->CombatRangeEnd(MainCharacter);
+			break;
+		default:
+			;
+		}
+	}
+	PendingProximityEvents.Reset();
+}
+
+// Called by UpdateProximity() before the pass
+void UEnemyManagerSubsystem::ApplyLineOfSightResults()
+{
+	TArray<TPair<AEnemy*, bool>> Results;
+	LineOfSight.GatherResults(GetWorld(), Results);
+	for (const TPair<AEnemy*, bool>& Result : Results)
+	{
+		const int32 Index = Result.Key->ManagerIndex;
+		if (Enemies.IsValidIndex(Index) && Enemies[Index] == Result.Key) // The enemy may have been unregistered since
+		{
+			SetFlag(Index, EEnemyFlags::HasLineOfSight, Result.Value);
+		}
+	}
+}
+
+// Called by UpdateProximity() after the pass, round robin over the candidates so every enemy gets traced
+void UEnemyManagerSubsystem::SubmitLineOfSightTraces(AMainCharacter* MainCharacter)
+{
+	if (LineOfSightCandidates.Num() == 0) return;
+
+	// Enemies traced the longest ago first
+	if (LineOfSightCandidates.Num() > LineOfSight.TracesPerFrame)
+	{
+		LineOfSightCandidates.Sort([this](int32 A, int32 B) { return LineOfSightStamps[A] < LineOfSightStamps[B]; });
+	}
+
+	TArray<AEnemy*> Traced;
+	const int32 NumTraces = FMath::Min(LineOfSightCandidates.Num(), LineOfSight.TracesPerFrame);
+	for (int32 i = 0; i < NumTraces; ++i)
+	{
+		const int32 Index = LineOfSightCandidates[i];
+		LineOfSightStamps[Index] = ProximityStamp;
+		Traced.Add(Enemies[Index]);
+	}
+	LineOfSight.SubmitTraces(GetWorld(), MainCharacter, Traced);
+}
+
+// Called every frame from Tick(), one field towards the player is shared by every chasing enemy in flow field mode
+void UEnemyManagerSubsystem::UpdateFlowField(AMainCharacter* MainCharacter)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyFlowField);
+
+	TArray<int32, TInlineAllocator<64>> Followers;
+	if (MainCharacter)
+	{
+		for (int32 Index = 0; Index < Enemies.Num(); ++Index)
+		{
+			if ((EnemyFlags[Index] & EEnemyFlags::FlowField) && MovementStatuses[Index] == EEnemyMovementStatus::EMS_MoveToTarget)
+			{
+				Followers.Add(Index);
+			}
+		}
+	}
+	SET_DWORD_STAT(STAT_FlowFieldFollowers, Followers.Num());
+
+	// The field is only kept up to date while someone follows it
+	if (Followers.Num() == 0) return;
+
+	const FVector PlayerLocation = MainCharacter->GetActorLocation();
+	FlowField.Update(GetWorld(), PlayerLocation);
+
+	for (int32 Index : Followers)
+	{
+		// Straight to the player when the field has no direction yet (first build running, goal cell or outside of the grid)
+		FVector Direction;
+		if (!FlowField.SampleDirection(Locations[Index], Direction))
+		{
+			Direction = (PlayerLocation - Locations[Index]).GetSafeNormal2D();
+		}
+		Enemies[Index]->AddMovementInput(Direction);
+	}
+}
+
+// Called every frame from Tick(), enemies far away from the player (or outside of the camera view) are updated less often
+void UEnemyManagerSubsystem::UpdateSignificance(AMainCharacter* MainCharacter)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemySignificance);
+
+	FMemory::Memzero(TierCounts);
+
+	// The view is the camera of the local player, without a player or a camera every enemy stays at full significance
+	APlayerController* PlayerController = UGameplayStatics::GetPlayerController(GetWorld(), 0);
+	if (MainCharacter == nullptr || PlayerController == nullptr || PlayerController->PlayerCameraManager == nullptr)
+	{
+		for (int32 Index = 0; Index < Enemies.Num(); ++Index)
+		{
+			Significances[Index] = EEnemySignificance::ES_Full;
+			Enemies[Index]->SetSignificance(EEnemySignificance::ES_Full);
+		}
+		TierCounts[(uint8)EEnemySignificance::ES_Full] = Enemies.Num();
+		return;
+	}
+
+	const FVector PlayerLocation = MainCharacter->GetActorLocation();
+
+	const FVector ViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+	const FVector ViewDirection = PlayerController->PlayerCameraManager->GetCameraRotation().Vector();
+	// Half of the horizontal FOV plus a margin, so enemies right on the edge of the screen still count as visible
+	const float ViewCosine = FMath::Cos(FMath::DegreesToRadians(FMath::Min(PlayerController->PlayerCameraManager->GetFOVAngle() * 0.5f + 10.f, 180.f)));
+
+	// Tier thresholds, boundary N separates tier N from tier N + 1
+	const float Thresholds[3] = { ReducedSignificanceDistance, AnimThrottledSignificanceDistance, DormantSignificanceDistance };
+
+	HibernationCandidates.Reset();
+	const float HibernationDistanceSquared = FMath::Square(FMath::Max(HibernationDistance, WakeDistance));
+
+	for (int32 Index = 0; Index < Enemies.Num(); ++Index)
+	{
+		EEnemySignificance NewTier = EEnemySignificance::ES_Full;
+
+		// Engaged enemies (chasing or fighting the player) are always updated at full rate
+		const bool bEngaged = (EnemyFlags[Index] & (EEnemyFlags::InAgroRange | EEnemyFlags::Attacking)) != 0;
+		if (!bEngaged)
+		{
+			// Score, distance to the player scaled up for enemies outside of the camera view
+			float Distance = FVector::Dist(Locations[Index], PlayerLocation);
+			const FVector ToEnemy = (Locations[Index] - ViewLocation).GetSafeNormal();
+			if (FVector::DotProduct(ToEnemy, ViewDirection) < ViewCosine)
+			{
+				Distance *= OffscreenDistanceScale;
+			}
+
+			// Hysteresis, a boundary the enemy is already past only moves it back once the distance drops under the threshold,
+			// a boundary the enemy is not past yet needs the extra hysteresis distance to demote it
+			const uint8 CurrentTier = (uint8)Significances[Index];
+			uint8 Tier = 0;
+			for (uint8 Boundary = 0; Boundary < 3; ++Boundary)
+			{
+				const float Threshold = (CurrentTier > Boundary) ? Thresholds[Boundary] : Thresholds[Boundary] * (1.f + SignificanceHysteresis);
+				if (Distance > Threshold)
+				{
+					Tier = Boundary + 1;
+				}
+			}
+			NewTier = (EEnemySignificance)Tier;
+		}
+
+		if (NewTier != Significances[Index])
+		{
+			Significances[Index] = NewTier;
+			Enemies[Index]->SetSignificance(NewTier);
+		}
+		++TierCounts[(uint8)NewTier];
+
+		// Dormant enemies far away that never saw the player go to hibernation
+		if (NewTier == EEnemySignificance::ES_Dormant && !Enemies[Index]->bHasBeenAggroed &&
+			MovementStatuses[Index] != EEnemyMovementStatus::EMS_Dead &&
+			FVector::DistSquared(Locations[Index], PlayerLocation) > HibernationDistanceSquared)
+		{
+			HibernationCandidates.Add(Index);
+		}
+	}
+
+	// Highest index first, the swap removal only moves enemies that were already handled
+	for (int32 i = HibernationCandidates.Num() - 1; i >= 0; --i)
+	{
+		--TierCounts[(uint8)EEnemySignificance::ES_Dormant];
+		HibernateEnemy(HibernationCandidates[i]);
+	}
+
+	SET_DWORD_STAT(STAT_SignificanceFull, TierCounts[(uint8)EEnemySignificance::ES_Full]);
+	SET_DWORD_STAT(STAT_SignificanceReduced, TierCounts[(uint8)EEnemySignificance::ES_Reduced]);
+	SET_DWORD_STAT(STAT_SignificanceAnimThrottled, TierCounts[(uint8)EEnemySignificance::ES_AnimThrottled]);
+	SET_DWORD_STAT(STAT_SignificanceDormant, TierCounts[(uint8)EEnemySignificance::ES_Dormant]);
+
+	// Debug view
+	const int32 ShowSignificance = CVarShowEnemySignificance.GetValueOnGameThread();
+	if (ShowSignificance > 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)this, 0.f, FColor::Yellow, FString::Printf(TEXT("Enemy significance - Full: %d  Reduced: %d  AnimThrottled: %d  Dormant: %d"),
+			TierCounts[(uint8)EEnemySignificance::ES_Full], TierCounts[(uint8)EEnemySignificance::ES_Reduced],
+			TierCounts[(uint8)EEnemySignificance::ES_AnimThrottled], TierCounts[(uint8)EEnemySignificance::ES_Dormant]));
+
+		if (ShowSignificance > 1)
+		{
+			static const FColor TierColors[(uint8)EEnemySignificance::ES_MAX] = { FColor::Green, FColor::Yellow, FColor::Orange, FColor::Red };
+			for (int32 Index = 0; Index < Enemies.Num(); ++Index)
+			{
+				DrawDebugPoint(GetWorld(), Locations[Index] + FVector(0.f, 0.f, 120.f), 12.f, TierColors[(uint8)Significances[Index]]);
+			}
+		}
+	}
+}
+
+// Called by UpdateProximity(), events are queued in the same order the overlap events used to fire
+void UEnemyManagerSubsystem::UpdateProximityState(int32 Index, bool bInAgroRange, bool bInCombatRange)
+{
+	AEnemy* Enemy = Enemies[Index];
+	const bool bWasInAgroRange = (EnemyFlags[Index] & EEnemyFlags::InAgroRange) != 0;
+	const bool bWasInCombatRange = (EnemyFlags[Index] & EEnemyFlags::InCombatRange) != 0;
+
+	if (bInAgroRange && !bWasInAgroRange)
+	{
+		SetFlag(Index, EEnemyFlags::InAgroRange, true);
+		EnemiesInAgroRange.Add(Enemy);
+		PendingProximityEvents.Add({ Enemy, EProximityEvent::AgroBegin });
+	}
+	if (bInCombatRange && !bWasInCombatRange)
+	{
+		SetFlag(Index, EEnemyFlags::InCombatRange, true);
+		PendingProximityEvents.Add({ Enemy, EProximityEvent::CombatBegin });
+	}
+	if (!bInCombatRange && bWasInCombatRange)
+	{
+		SetFlag(Index, EEnemyFlags::InCombatRange, false);
+		NearestIndex.Remove(Enemy);
+		PendingProximityEvents.Add({ Enemy, EProximityEvent::CombatEnd });
+	}
+	if (!bInAgroRange && bWasInAgroRange)
+	{
+		SetFlag(Index, EEnemyFlags::InAgroRange, false);
+		EnemiesInAgroRange.RemoveSingleSwap(Enemy, false);
+		PendingProximityEvents.Add({ Enemy, EProximityEvent::AgroEnd });
+	}
+}
+
+// Called by AEnemy::MoveToTarget() when the enemy starts chasing
+bool UEnemyManagerSubsystem::UsesFlowField(const AEnemy* Enemy) const
+{
+	switch (CVarEnemyNavigationMode.GetValueOnGameThread())
+	{
+	case 1:
+		return false;
+	case 2:
+		return true;
+	default:
+		return Enemy && Enemy->NavigationMode == EEnemyNavigationMode::ENM_FlowField;
+	}
+}
+
+// Returns every enemy in combat range, unsorted
+void UEnemyManagerSubsystem::GetEnemiesInCombatRange(TArray<AEnemy*>& OutEnemies, TSubclassOf<AEnemy> Filter) const
+{
+	OutEnemies.Reset();
+	for (AEnemy* Enemy : EnemiesInAgroRange) // Combat range is always inside the agro range
+	{
+		const int32 Index = Enemy->ManagerIndex;
+		if ((EnemyFlags[Index] & EEnemyFlags::InCombatRange) &&
+			MovementStatuses[Index] != EEnemyMovementStatus::EMS_Dead &&
+			(!Filter || Enemy->IsA(Filter)))
+		{
+			OutEnemies.Add(Enemy);
+		}
+	}
+}
+
+// Called by AMainCharacter::UpdateCombatTarget() and AMainCharacter::Tick()
+AEnemy* UEnemyManagerSubsystem::GetNearestEnemyInCombatRange(TSubclassOf<AEnemy> Filter) const
+{
+	return NearestIndex.GetNearest([Filter](AEnemy* Enemy) { return !Filter || Enemy->IsA(Filter); });
+}
+
+// Same as GetNearestEnemyInCombatRange() for the Count nearest enemies
+void UEnemyManagerSubsystem::GetNearestEnemiesInCombatRange(int32 Count, TArray<AEnemy*>& OutEnemies, TSubclassOf<AEnemy> Filter) const
+{
+	NearestIndex.GetNearest(Count, OutEnemies, [Filter](AEnemy* Enemy) { return !Filter || Enemy->IsA(Filter); });
+}
+
+// Called from AEnemy::BeginPlay()
+void UEnemyManagerSubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr || Enemy->ManagerIndex != INDEX_NONE) return;
+
+	Enemy->ManagerIndex = Enemies.Add(Enemy);
+	CombatTargets.Add(Enemy->CombatTarget);
+	Locations.Add(Enemy->GetActorLocation());
+	MovementStatuses.Add(Enemy->EnemyMovementStatus);
+
+	uint8 Flags = EEnemyFlags::None;
+	if (Enemy->bAttacking) Flags |= EEnemyFlags::Attacking;
+	if (Enemy->bHasValidTarget) Flags |= EEnemyFlags::HasValidTarget;
+	if (Enemy->bOverlappingCombatSphere) Flags |= EEnemyFlags::OverlappingCombatSphere;
+	EnemyFlags.Add(Flags);
+
+	// Proximity ranges, the exit distances add the hysteresis so enemies on the edge don't flicker in and out
+	FEnemyProximityRanges Ranges;
+	Ranges.AgroEnter = Enemy->AgroRadius;
+	Ranges.AgroExit = Enemy->AgroRadius + Enemy->ProximityHysteresis;
+	Ranges.CombatEnter = Enemy->CombatRadius;
+	Ranges.CombatExit = Enemy->CombatRadius + Enemy->ProximityHysteresis;
+	ProximityRanges.Add(Ranges);
+	ProximityStamps.Add(0);
+	Significances.Add(Enemy->Significance);
+	LineOfSightStamps.Add(0);
+	MaxProximityRange = FMath::Max(MaxProximityRange, FMath::Max(Ranges.AgroExit, Ranges.CombatExit));
+}
+
+// Called from AEnemy::Disappear() and AEnemy::EndPlay()
+void UEnemyManagerSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy && HibernatingEnemies.IsValidIndex(Enemy->HibernationIndex) && HibernatingEnemies[Enemy->HibernationIndex] == Enemy)
+	{
+		RemoveHibernatingAtSwap(Enemy->HibernationIndex);
+		return;
+	}
+	if (Enemy == nullptr || !Enemies.IsValidIndex(Enemy->ManagerIndex) || Enemies[Enemy->ManagerIndex] != Enemy) return;
+
+	EnemiesInAgroRange.RemoveSingleSwap(Enemy, false);
+	NearestIndex.Remove(Enemy);
+	CombatDirector.CancelAttack(Enemy);
+	CombatDirector.ReleaseToken(Enemy);
+	RemoveAtSwap(Enemy->ManagerIndex);
+	Enemy->ManagerIndex = INDEX_NONE;
+}
+
+// Called by AEnemy::SetEnemyMovementStatus()
+void UEnemyManagerSubsystem::SetMovementStatus(int32 Index, EEnemyMovementStatus Status)
+{
+	MovementStatuses[Index] = Status;
+	if (Status == EEnemyMovementStatus::EMS_Dead)
+	{
+		NearestIndex.Remove(Enemies[Index]); // Can't be the combat target anymore, even before the next proximity pass
+	}
+}
+
+// Called by the AEnemy setters for the boolean state
+void UEnemyManagerSubsystem::SetFlag(int32 Index, EEnemyFlags::Type Flag, bool bValue)
+{
+	if (bValue)
+	{
+		EnemyFlags[Index] |= Flag;
+	}
+	else
+	{
+		EnemyFlags[Index] &= ~Flag;
+	}
+}
+
+// Called by AEnemy::SetCombatTarget()
+void UEnemyManagerSubsystem::SetCombatTarget(int32 Index, AMainCharacter* Target)
+{
+	CombatTargets[Index] = Target;
+}
+
+// Removes one enemy from every array, the last enemy is moved into the empty slot so the arrays stay packed
+void UEnemyManagerSubsystem::RemoveAtSwap(int32 Index)
+{
+	Enemies.RemoveAtSwap(Index, 1, false);
+	CombatTargets.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	MovementStatuses.RemoveAtSwap(Index, 1, false);
+	EnemyFlags.RemoveAtSwap(Index, 1, false);
+	ProximityRanges.RemoveAtSwap(Index, 1, false);
+	ProximityStamps.RemoveAtSwap(Index, 1, false);
+	Significances.RemoveAtSwap(Index, 1, false);
+	LineOfSightStamps.RemoveAtSwap(Index, 1, false);
+
+	if (Enemies.IsValidIndex(Index))
+	{
+		Enemies[Index]->ManagerIndex = Index; // Fixing the index of the enemy that was moved
+	}
+}
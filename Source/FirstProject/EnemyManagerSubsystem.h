@@ -0,0 +1,359 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that owns every enemy in the level. It keeps the hot state of the enemies
+ * in parallel arrays (structure of arrays, all of them share the same index) and updates
+ * every registered enemy in a single pass each frame, instead of each enemy ticking on its own.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Enemy.h"
+#include "EnemyProximityGrid.h"
+#include "EnemyPathService.h"
+#include "EnemyFlowField.h"
+#include "EnemyCombatDirector.h"
+#include "EnemyLineOfSight.h"
+#include "EnemyNearestIndex.h"
+#include "EnemyManagerSubsystem.generated.h"
+
+/** Bit flags stored per enemy in the EnemyFlags array */
+namespace EEnemyFlags
+{
+	enum Type : uint8
+	{
+		None = 0,
+		Attacking = 1 << 0,
+		HasValidTarget = 1 << 1,
+		OverlappingCombatSphere = 1 << 2,
+		InAgroRange = 1 << 3,
+		InCombatRange = 1 << 4,
+		FlowField = 1 << 5,
+		HasLineOfSight = 1 << 6,
+	};
+}
+
+/** Proximity ranges of one enemy, exit distances are bigger than enter distances (hysteresis) */
+struct FEnemyProximityRanges
+{
+	float AgroEnter;
+	float AgroExit;
+	float CombatEnter;
+	float CombatExit;
+};
+
+/**
+ * Settings are read from the [/Script/FirstProject.EnemyManagerSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UEnemyManagerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UEnemyManagerSubsystem();
+
+	/** Helper to get the manager of the world the object lives in */
+	static UEnemyManagerSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Only create the manager for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, sets up the services with the config values */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Inherited from UWorldSubsystem, clears all the arrays */
+	virtual void Deinitialize() override;
+
+	/** Inherited from FTickableGameObject, updates every registered enemy in one pass (and wakes the hibernating ones) */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Adds the enemy to the manager, called from AEnemy::BeginPlay() */
+	void RegisterEnemy(AEnemy* Enemy);
+
+	/** Removes the enemy from the manager, called from AEnemy::Disappear() */
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	/** Number of enemies currently registered */
+	FORCEINLINE int32 GetNumEnemies() const { return Enemies.Num(); }
+
+	/** Getter for the enemy stored at Index */
+	FORCEINLINE AEnemy* GetEnemy(int32 Index) const { return Enemies[Index]; }
+
+	/** Setters/Getters for the hot enemy state, Index is AEnemy::ManagerIndex */
+	void SetMovementStatus(int32 Index, EEnemyMovementStatus Status);
+	FORCEINLINE EEnemyMovementStatus GetMovementStatus(int32 Index) const { return MovementStatuses[Index]; }
+	void SetFlag(int32 Index, EEnemyFlags::Type Flag, bool bValue);
+	FORCEINLINE bool HasFlag(int32 Index, EEnemyFlags::Type Flag) const { return (EnemyFlags[Index] & Flag) != 0; }
+	void SetCombatTarget(int32 Index, class AMainCharacter* Target);
+	FORCEINLINE AMainCharacter* GetCombatTarget(int32 Index) const { return CombatTargets[Index]; }
+	FORCEINLINE const FVector& GetLocation(int32 Index) const { return Locations[Index]; }
+
+	/** Number of enemies hibernating, they are not part of the update pass */
+	FORCEINLINE int32 GetNumHibernatingEnemies() const { return HibernatingEnemies.Num(); }
+
+	/** Number of enemies in the significance tier */
+	FORCEINLINE int32 GetNumEnemiesInTier(EEnemySignificance Tier) const { return TierCounts[(uint8)Tier]; }
+
+
+	/// Significance settings
+	//
+	/** Distances to the player where the enemies go from Full to Reduced, Reduced to AnimThrottled and AnimThrottled to Dormant */
+	UPROPERTY(config)
+	float ReducedSignificanceDistance;
+	UPROPERTY(config)
+	float AnimThrottledSignificanceDistance;
+	UPROPERTY(config)
+	float DormantSignificanceDistance;
+
+	/** Distance multiplier for the enemies outside of the camera view, so they lose significance sooner */
+	UPROPERTY(config)
+	float OffscreenDistanceScale;
+
+	/** Fraction of the distance an enemy has to go past a tier threshold before it is demoted (hysteresis) */
+	UPROPERTY(config)
+	float SignificanceHysteresis;
+
+	/// Hibernation settings
+	//
+	/** Distance to the player past which a dormant enemy that never saw the player hibernates */
+	UPROPERTY(config)
+	float HibernationDistance;
+
+	/** Distance to the player under which a hibernating enemy wakes up, smaller than HibernationDistance */
+	UPROPERTY(config)
+	float WakeDistance;
+
+	/// Path settings
+	//
+	/** Distance the chased actor has to move before the enemies chasing it get a new path */
+	UPROPERTY(config)
+	float PathRepathDistance;
+
+	/** Max distance from an enemy to a cached path for the enemy to share it */
+	UPROPERTY(config)
+	float PathJoinDistance;
+
+	/** Getter for the path cache shared by the enemies */
+	FORCEINLINE FEnemyPathService& GetPathService() { return PathService; }
+
+	/// Flow field settings
+	//
+	/** Number of cells in every side of the flow field grid and size of a cell */
+	UPROPERTY(config)
+	int32 FlowFieldGridSize;
+	UPROPERTY(config)
+	float FlowFieldCellSize;
+
+	/** Frames between two builds of the flow field */
+	UPROPERTY(config)
+	int32 FlowFieldUpdateFrames;
+
+	/** Navmesh samples taken per frame to find the walkable cells of the flow field */
+	UPROPERTY(config)
+	int32 FlowFieldSamplesPerFrame;
+
+	/// Combat director settings
+	//
+	/** Number of enemies that can attack the player at once */
+	UPROPERTY(config)
+	int32 AttackTokensPerTarget;
+
+	/** Max enemy attacks started in one frame */
+	UPROPERTY(config)
+	int32 MaxAttackStartsPerFrame;
+
+	/** Seconds an enemy waits before trying to attack again when every token is taken */
+	UPROPERTY(config)
+	float AttackTokenRetryDelay;
+
+	/// Line of sight settings
+	//
+	/** Max line of sight traces submitted per frame, the enemies waiting the longest go first */
+	UPROPERTY(config)
+	int32 LineOfSightTracesPerFrame;
+
+	/** Getter for the attack scheduler shared by the enemies */
+	FORCEINLINE FEnemyCombatDirector& GetCombatDirector() { return CombatDirector; }
+
+	/** True when the enemy should chase the player with the flow field instead of a path (AEnemy::NavigationMode or the fp.EnemyNavigationMode override) */
+	bool UsesFlowField(const AEnemy* Enemy) const;
+
+	/** Fills OutEnemies with the living enemies that have the player inside their combat range
+	/* @param Filter: optional class the enemies must be derived from */
+	void GetEnemiesInCombatRange(TArray<AEnemy*>& OutEnemies, TSubclassOf<AEnemy> Filter = nullptr) const;
+
+	/** Nearest living enemy that has the player inside its combat range, read from the nearest enemy index
+	/* @param Filter: optional class the enemy must be derived from */
+	AEnemy* GetNearestEnemyInCombatRange(TSubclassOf<AEnemy> Filter = nullptr) const;
+
+	/** Fills OutEnemies with the Count nearest living enemies that have the player inside their combat range, nearest first */
+	void GetNearestEnemiesInCombatRange(int32 Count, TArray<AEnemy*>& OutEnemies, TSubclassOf<AEnemy> Filter = nullptr) const;
+
+private:
+	/// Structure of arrays, the same index is used in every array
+	//
+	/** Enemy actors, AEnemy::ManagerIndex is the index in this array */
+	UPROPERTY()
+	TArray<AEnemy*> Enemies;
+
+	/** Enemy targets (only valid while the player is inside the enemy combat range) */
+	UPROPERTY()
+	TArray<AMainCharacter*> CombatTargets;
+
+	/** Enemy locations, refreshed once per frame at the start of the update pass */
+	TArray<FVector> Locations;
+
+	/** Enemy movement status, mirrors AEnemy::EnemyMovementStatus */
+	TArray<EEnemyMovementStatus> MovementStatuses;
+
+	/** Packed EEnemyFlags bits (attacking, valid target, combat sphere, proximity ranges, flow field mode and line of sight) */
+	TArray<uint8> EnemyFlags;
+
+	/** Agro and combat ranges of every enemy (AEnemy::AgroRadius, CombatRadius and ProximityHysteresis) */
+	TArray<FEnemyProximityRanges> ProximityRanges;
+
+	/** Frame stamp of the last proximity query that found the enemy */
+	TArray<uint32> ProximityStamps;
+
+	/** Significance tier of every enemy, mirrors AEnemy::Significance */
+	TArray<EEnemySignificance> Significances;
+
+	/** Proximity stamp of the last line of sight trace of every enemy, the oldest ones are traced first */
+	TArray<uint32> LineOfSightStamps;
+
+
+	/// Significance
+	//
+	/** Number of enemies in every tier after the last update */
+	int32 TierCounts[(uint8)EEnemySignificance::ES_MAX];
+
+	/** Scores every enemy by distance and view relevance and moves it to the matching tier */
+	void UpdateSignificance(class AMainCharacter* MainCharacter);
+
+
+	/// Hibernation
+	//
+	/** What one enemy turned off when it went to hibernation */
+	struct FHibernationSavings
+	{
+		int32 TicksDisabled;
+		int32 CollisionsDisabled;
+	};
+
+	/** Proxy records of the hibernating enemies, AEnemy::HibernationIndex is the index in every array */
+	UPROPERTY()
+	TArray<AEnemy*> HibernatingEnemies;
+	TArray<FVector> HibernatingLocations;
+	TArray<FHibernationSavings> HibernatingSavings;
+
+	/** Sums of HibernatingSavings */
+	int32 HibernationTicksDisabled;
+	int32 HibernationCollisionsDisabled;
+
+	/** Enemies picked by the significance pass to hibernate at the end of the pass */
+	TArray<int32> HibernationCandidates;
+
+	/** Average time of the per-enemy passes (location refresh and significance) per registered enemy over the last frame, in microseconds */
+	float UpdateTimePerEnemy;
+
+	/** Value of fp.EnemyNavWalking the enemies were last switched to */
+	bool bNavWalkingAllowed;
+
+	/** Removes the enemy from the update pass and keeps only its proxy record */
+	void HibernateEnemy(int32 Index);
+
+	/** Counts the component ticks (enemy and controller) and the collision primitives the sleeping enemy has turned off */
+	static void CountHibernationSavings(AEnemy* Enemy, FHibernationSavings& OutSavings);
+
+	/** Wakes up the hibernating enemies the player got close to and adds them back to the update pass */
+	void UpdateHibernation(class AMainCharacter* MainCharacter);
+
+	/** Removes the proxy record at HibernationIndex and fixes the index of the proxy moved into its place */
+	void RemoveHibernatingAtSwap(int32 HibernationIndex);
+
+	/** Bytes the manager stores per registered enemy, the SoA arrays added up */
+	static int32 GetBytesPerRegisteredEnemy();
+
+
+	/// Proximity service
+	//
+	/** Proximity event raised to the enemies after the proximity pass */
+	enum class EProximityEvent : uint8
+	{
+		AgroBegin,
+		AgroEnd,
+		CombatBegin,
+		CombatEnd
+	};
+
+	struct FPendingProximityEvent
+	{
+		AEnemy* Enemy;
+		EProximityEvent Event;
+	};
+
+	/** Spatial hash over the Locations array */
+	FEnemyProximityGrid ProximityGrid;
+
+	/** Events collected during the proximity pass, raised once the pass is done */
+	TArray<FPendingProximityEvent> PendingProximityEvents;
+
+	/** Enemies that currently have the player inside their agro range */
+	TArray<AEnemy*> EnemiesInAgroRange;
+
+	/** Enemies in combat range sorted by distance to the player, updated by the proximity pass */
+	FEnemyNearestIndex NearestIndex;
+
+	/** Biggest AgroExit of the registered enemies, used as the grid query radius */
+	float MaxProximityRange;
+
+	/** Incremented every proximity pass */
+	uint32 ProximityStamp;
+
+	/** Finds the enemies that the player entered or exited and raises the begin/end events */
+	void UpdateProximity(class AMainCharacter* MainCharacter);
+
+	/** Sets the range flags of the enemy to the new state and queues the matching events */
+	void UpdateProximityState(int32 Index, bool bInAgroRange, bool bInCombatRange);
+
+	/// Line of sight
+	//
+	/** Async traces from the enemies to the player, an enemy only starts chasing once it can see the player */
+	FEnemyLineOfSight LineOfSight;
+
+	/** Enemies inside their agro radius still waiting for a line of sight result, found by the proximity pass */
+	TArray<int32> LineOfSightCandidates;
+
+	/** Sets the HasLineOfSight flag from the traces of the previous frame */
+	void ApplyLineOfSightResults();
+
+	/** Submits the traces of the candidates that waited the longest, up to the per frame budget */
+	void SubmitLineOfSightTraces(class AMainCharacter* MainCharacter);
+
+	/// Paths
+	//
+	/** Path cache and repath policy for AEnemy::MoveToTarget() */
+	FEnemyPathService PathService;
+
+	/// Flow field
+	//
+	/** Field towards the player shared by the enemies in flow field mode */
+	FEnemyFlowField FlowField;
+
+	/** Updates the flow field and moves the chasing enemies in flow field mode along it */
+	void UpdateFlowField(class AMainCharacter* MainCharacter);
+
+	/// Combat
+	//
+	/** Attack queue and attack tokens of every target */
+	FEnemyCombatDirector CombatDirector;
+
+	/** Removes the element at Index from every array and fixes the index of the enemy moved into its place */
+	void RemoveAtSwap(int32 Index);
+};
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyNearestIndex.h"
+#include "Enemy.h"
+
+
+// Called by UEnemyManagerSubsystem::UpdateProximity() for every enemy in combat range
+void FEnemyNearestIndex::Update(AEnemy* Enemy, float DistanceSquared)
+{
+	int32 Slot = Enemy->NearestIndexSlot;
+	if (!Heap.IsValidIndex(Slot) || Heap[Slot].Enemy != Enemy)
+	{
+		// New enemy, added at the bottom and moved up to its place
+		Slot = Heap.Num();
+		Place(Heap.AddUninitialized(), { Enemy, DistanceSquared });
+		SiftUp(Slot);
+		return;
+	}
+
+	const float OldDistanceSquared = Heap[Slot].DistanceSquared;
+	Heap[Slot].DistanceSquared = DistanceSquared;
+	if (DistanceSquared < OldDistanceSquared)
+	{
+		SiftUp(Slot);
+	}
+	else
+	{
+		SiftDown(Slot);
+	}
+}
+
+// Called when the enemy exits the combat range, dies or is unregistered
+void FEnemyNearestIndex::Remove(AEnemy* Enemy)
+{
+	const int32 Slot = Enemy->NearestIndexSlot;
+	if (!Heap.IsValidIndex(Slot) || Heap[Slot].Enemy != Enemy) return;
+	Enemy->NearestIndexSlot = INDEX_NONE;
+
+	// The last entry takes the free slot and moves up or down from there
+	const FEntry Last = Heap.Pop(false);
+	if (Slot == Heap.Num()) return;
+
+	const float RemovedDistanceSquared = Heap[Slot].DistanceSquared;
+	Place(Slot, Last);
+	if (Last.DistanceSquared < RemovedDistanceSquared)
+	{
+		SiftUp(Slot);
+	}
+	else
+	{
+		SiftDown(Slot);
+	}
+}
+
+// Called when the enemy manager is deinitialized
+void FEnemyNearestIndex::Reset()
+{
+	for (const FEntry& Entry : Heap)
+	{
+		Entry.Enemy->NearestIndexSlot = INDEX_NONE;
+	}
+	Heap.Empty();
+}
+
+// Moves the entry towards the root while it is nearer than its parent
+void FEnemyNearestIndex::SiftUp(int32 Slot)
+{
+	const FEntry Entry = Heap[Slot];
+	while (Slot > 0)
+	{
+		const int32 Parent = (Slot - 1) / 2;
+		if (Heap[Parent].DistanceSquared <= Entry.DistanceSquared) break;
+		Place(Slot, Heap[Parent]);
+		Slot = Parent;
+	}
+	Place(Slot, Entry);
+}
+
+// Moves the entry towards the leaves while one of its children is nearer
+void FEnemyNearestIndex::SiftDown(int32 Slot)
+{
+	const FEntry Entry = Heap[Slot];
+	const int32 Num = Heap.Num();
+	while (true)
+	{
+		int32 Child = 2 * Slot + 1;
+		if (Child >= Num) break;
+		if (Child + 1 < Num && Heap[Child + 1].DistanceSquared < Heap[Child].DistanceSquared)
+		{
+			++Child;
+		}
+		if (Entry.DistanceSquared <= Heap[Child].DistanceSquared) break;
+		Place(Slot, Heap[Child]);
+		Slot = Child;
+	}
+	Place(Slot, Entry);
+}
+
+// Called every time an entry moves
+void FEnemyNearestIndex::Place(int32 Slot, const FEntry& Entry)
+{
+	Heap[Slot] = Entry;
+	Entry.Enemy->NearestIndexSlot = Slot;
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Indexed binary min-heap of the enemies that have the player inside their combat range, keyed by their squared
+ * distance to the player. Kept up to date by the UEnemyManagerSubsystem proximity pass (O(log n) per enemy that
+ * moves), so the nearest enemy is read in O(1) and the nearest N in O(N log N) without scanning every enemy.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AEnemy;
+
+class FIRSTPROJECT_API FEnemyNearestIndex
+{
+public:
+	/** Adds the enemy or moves it to its new distance, AEnemy::NearestIndexSlot keeps its place in the heap */
+	void Update(AEnemy* Enemy, float DistanceSquared);
+
+	/** Removes the enemy, nothing happens when it isn't in the index */
+	void Remove(AEnemy* Enemy);
+
+	/** Nearest enemy accepted by Predicate(AEnemy*), nullptr when there is none */
+	template<typename PredicateType>
+	AEnemy* GetNearest(PredicateType&& Predicate) const;
+
+	/** Fills OutEnemies with the Count nearest enemies accepted by Predicate(AEnemy*), nearest first */
+	template<typename PredicateType>
+	void GetNearest(int32 Count, TArray<AEnemy*>& OutEnemies, PredicateType&& Predicate) const;
+
+	/** Removes every enemy */
+	void Reset();
+
+	FORCEINLINE int32 Num() const { return Heap.Num(); }
+
+private:
+	struct FEntry
+	{
+		AEnemy* Enemy;
+		float DistanceSquared;
+	};
+
+	/** Calls Func(AEnemy*) from the nearest enemy to the farthest until it returns false */
+	template<typename FunctorType>
+	void ForEachNearest(FunctorType&& Func) const;
+
+	void SiftUp(int32 Slot);
+	void SiftDown(int32 Slot);
+
+	/** Writes the entry in the slot and tells the enemy where it is */
+	void Place(int32 Slot, const FEntry& Entry);
+
+	TArray<FEntry> Heap;
+};
+
+template<typename FunctorType>
+void FEnemyNearestIndex::ForEachNearest(FunctorType&& Func) const
+{
+	if (Heap.Num() == 0) return;
+
+	// Best first walk, a child is never nearer than its parent so the next nearest enemy is always in the frontier
+	TArray<int32, TInlineAllocator<32>> Frontier;
+	const auto IsNearer = [this](int32 A, int32 B) { return Heap[A].DistanceSquared < Heap[B].DistanceSquared; };
+	Frontier.Add(0);
+	while (Frontier.Num() > 0)
+	{
+		int32 Slot;
+		Frontier.HeapPop(Slot, IsNearer, false);
+		if (!Func(Heap[Slot].Enemy)) return;
+
+		for (int32 Child = 2 * Slot + 1; Child <= 2 * Slot + 2 && Child < Heap.Num(); ++Child)
+		{
+			Frontier.HeapPush(Child, IsNearer);
+		}
+	}
+}
+
+template<typename PredicateType>
+AEnemy* FEnemyNearestIndex::GetNearest(PredicateType&& Predicate) const
+{
+	AEnemy* Nearest = nullptr;
+	ForEachNearest([&](AEnemy* Enemy)
+	{
+		if (!Predicate(Enemy)) return true;
+		Nearest = Enemy;
+		return false;
+	});
+	return Nearest;
+}
+
+template<typename PredicateType>
+void FEnemyNearestIndex::GetNearest(int32 Count, TArray<AEnemy*>& OutEnemies, PredicateType&& Predicate) const
+{
+	OutEnemies.Reset();
+	if (Count <= 0) return;
+
+	ForEachNearest([&](AEnemy* Enemy)
+	{
+		if (Predicate(Enemy))
+		{
+			OutEnemies.Add(Enemy);
+		}
+		return OutEnemies.Num() < Count;
+	});
+}
@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyPathService.h"
+#include "FirstProject.h"
+#include "Enemy.h"
+#include "MainCharacter.h"
+#include "AIController.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Path Service"), STAT_EnemyPathService, STATGROUP_Enemies);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Navmesh Path Queries"), STAT_NavmeshPathQueries, STATGROUP_Enemies);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Path Requests Per Second"), STAT_PathRequestsPerSecond, STATGROUP_Enemies);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Path Cache Hit Rate %"), STAT_PathCacheHitRate, STATGROUP_Enemies);
+
+
+// Sets default values
+FEnemyPathService::FEnemyPathService()
+{
+	RepathDistance = 75.f;
+	JoinDistance = 300.f;
+	MaxCorridorsPerGoal = 8;
+	RequestsThisWindow = 0;
+	HitsThisWindow = 0;
+	WindowTime = 0.f;
+}
+
+// Called by AEnemy::MoveToTarget()
+FNavPathSharedPtr FEnemyPathService::FindPath(AEnemy* Enemy, const FAIMoveRequest& MoveRequest)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyPathService);
+
+	AActor* Goal = MoveRequest.GetGoalActor();
+	UWorld* World = Enemy ? Enemy->GetWorld() : nullptr;
+	if (Goal == nullptr || World == nullptr || Enemy->AIController == nullptr) return nullptr;
+
+	++RequestsThisWindow;
+
+	FGoalPaths& Entry = FindOrAddGoal(Goal);
+	Entry.Followers.AddUnique(Enemy);
+
+	// Cache hit, the enemy joins a corridor another enemy already paid for
+	FNavPathSharedPtr Path = JoinCorridor(World, Entry, Enemy->GetNavAgentLocation());
+	if (Path.IsValid())
+	{
+		++HitsThisWindow;
+		return Path;
+	}
+
+	// Cache miss, running a real navmesh query and keeping the result for the rest of the pack
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	FPathFindingQuery Query;
+	if (NavSys == nullptr || !Enemy->AIController->BuildPathfindingQuery(MoveRequest, Query)) return nullptr;
+
+	INC_DWORD_STAT(STAT_NavmeshPathQueries);
+	FPathFindingResult Result = NavSys->FindPathSync(Query);
+	if (!Result.IsSuccessful() || !Result.Path.IsValid()) return nullptr;
+
+	if (Entry.Corridors.Num() == 0)
+	{
+		Entry.GoalLocation = Goal->GetActorLocation();
+	}
+	if (Entry.Corridors.Num() >= MaxCorridorsPerGoal)
+	{
+		Entry.Corridors.RemoveAt(0); // Dropping the oldest corridor
+	}
+	Entry.Corridors.Add(Result.Path);
+
+	return Result.Path;
+}
+
+// Called by FindPath(), the new path goes straight to the closest corridor point and then follows the corridor
+FNavPathSharedPtr FEnemyPathService::JoinCorridor(UWorld* World, const FGoalPaths& Entry, const FVector& Start) const
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	if (NavSys == nullptr) return nullptr;
+
+	for (const FNavPathSharedPtr& Corridor : Entry.Corridors)
+	{
+		if (!Corridor->IsValid() || !Corridor->IsUpToDate()) continue;
+
+		// Closest corridor point to the enemy
+		const TArray<FNavPathPoint>& Points = Corridor->GetPathPoints();
+		int32 JoinIndex = INDEX_NONE;
+		float ClosestDistanceSquared = FMath::Square(JoinDistance);
+		for (int32 Index = 0; Index < Points.Num(); ++Index)
+		{
+			const float DistanceSquared = FVector::DistSquared(Points[Index].Location, Start);
+			if (DistanceSquared <= ClosestDistanceSquared)
+			{
+				ClosestDistanceSquared = DistanceSquared;
+				JoinIndex = Index;
+			}
+		}
+		if (JoinIndex == INDEX_NONE) continue;
+
+		// The enemy can only join if it can walk straight to the corridor (a navmesh raycast is much cheaper than a path query)
+		FVector HitLocation;
+		if (NavSys->NavigationRaycast(World, Start, Points[JoinIndex].Location, HitLocation)) continue;
+
+		TArray<FVector> PathPoints;
+		PathPoints.Reserve(Points.Num() - JoinIndex + 1);
+		PathPoints.Add(Start);
+		for (int32 Index = JoinIndex; Index < Points.Num(); ++Index)
+		{
+			PathPoints.Add(Points[Index].Location);
+		}
+
+		FNavPathSharedPtr Path = MakeShareable(new FNavigationPath(PathPoints));
+		Path->SetNavigationDataUsed(Corridor->GetNavigationDataUsed());
+		return Path;
+	}
+
+	return nullptr;
+}
+
+// Called every frame by UEnemyManagerSubsystem::Tick()
+void FEnemyPathService::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyPathService);
+
+	// Stats, averaged over one second
+	WindowTime += DeltaTime;
+	if (WindowTime >= 1.f)
+	{
+		SET_FLOAT_STAT(STAT_PathRequestsPerSecond, RequestsThisWindow / WindowTime);
+		SET_FLOAT_STAT(STAT_PathCacheHitRate, RequestsThisWindow > 0 ? 100.f * HitsThisWindow / RequestsThisWindow : 0.f);
+		RequestsThisWindow = 0;
+		HitsThisWindow = 0;
+		WindowTime = 0.f;
+	}
+
+	// Enemies that need a new path, repathed after the loop because MoveToTarget() adds them back to the cache
+	TArray<TPair<AEnemy*, AMainCharacter*>, TInlineAllocator<16>> Repaths;
+
+	for (int32 Index = GoalPaths.Num() - 1; Index >= 0; --Index)
+	{
+		FGoalPaths& Entry = GoalPaths[Index];
+		AActor* Goal = Entry.Goal.Get();
+		if (Goal == nullptr)
+		{
+			GoalPaths.RemoveAtSwap(Index);
+			continue;
+		}
+		if (Entry.Corridors.Num() == 0) continue;
+
+		// Repath policy, only when the goal moved far enough or the navmesh changed under a corridor
+		bool bRepath = FVector::DistSquared(Goal->GetActorLocation(), Entry.GoalLocation) > FMath::Square(RepathDistance);
+		for (const FNavPathSharedPtr& Corridor : Entry.Corridors)
+		{
+			bRepath |= !Corridor->IsValid() || !Corridor->IsUpToDate();
+		}
+		if (!bRepath) continue;
+
+		Entry.Corridors.Reset();
+		AMainCharacter* Target = Cast<AMainCharacter>(Goal);
+		for (const TWeakObjectPtr<AEnemy>& Follower : Entry.Followers)
+		{
+			// Only the enemies still chasing, the ones attacking or idle ask for a path again when they start chasing
+			AEnemy* Enemy = Follower.Get();
+			if (Enemy && Target && Enemy->GetEnemyMovementStatus() == EEnemyMovementStatus::EMS_MoveToTarget)
+			{
+				Repaths.Add(TPair<AEnemy*, AMainCharacter*>(Enemy, Target));
+			}
+		}
+		Entry.Followers.Reset();
+	}
+
+	// The first enemy of the pack computes the new corridor and the rest join it
+	for (const TPair<AEnemy*, AMainCharacter*>& Repath : Repaths)
+	{
+		Repath.Key->MoveToTarget(Repath.Value);
+	}
+}
+
+// Called when the enemy manager is deinitialized
+void FEnemyPathService::Reset()
+{
+	GoalPaths.Empty();
+}
+
+// Returns the cache entry of the goal
+FEnemyPathService::FGoalPaths& FEnemyPathService::FindOrAddGoal(AActor* Goal)
+{
+	for (FGoalPaths& Entry : GoalPaths)
+	{
+		if (Entry.Goal.Get() == Goal)
+		{
+			return Entry;
+		}
+	}
+
+	FGoalPaths& Entry = GoalPaths.AddDefaulted_GetRef();
+	Entry.Goal = Goal;
+	Entry.GoalLocation = Goal->GetActorLocation();
+	return Entry;
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Path cache shared by every enemy chasing the same goal actor. Enemies close to a corridor that was
+ * already computed for the goal join it instead of running their own navmesh query, and the corridors
+ * are only recomputed when the goal moves past RepathDistance or the navmesh invalidates them.
+ * Owned and ticked by the UEnemyManagerSubsystem.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+
+class AEnemy;
+class AAIController;
+struct FAIMoveRequest;
+
+class FIRSTPROJECT_API FEnemyPathService
+{
+public:
+	FEnemyPathService();
+
+	/** Returns a path for the enemy to the goal of the move request, taken from the cache when possible
+	/* @param Enemy: enemy asking for the path, it is repathed by the service when the goal moves
+	/* @param MoveRequest: move request with the goal actor set */
+	FNavPathSharedPtr FindPath(AEnemy* Enemy, const FAIMoveRequest& MoveRequest);
+
+	/** Checks the goals of the cached corridors and repaths the enemies chasing a goal that moved or a blocked corridor */
+	void Tick(float DeltaTime);
+
+	/** Drops every cached corridor */
+	void Reset();
+
+	/** Distance the goal has to move before the corridors to it are recomputed */
+	float RepathDistance;
+
+	/** Max distance between an enemy and a corridor point for the enemy to join the corridor */
+	float JoinDistance;
+
+	/** Max number of corridors cached for a single goal */
+	int32 MaxCorridorsPerGoal;
+
+private:
+	/** Corridors computed towards one goal actor */
+	struct FGoalPaths
+	{
+		/** Actor the enemies are chasing */
+		TWeakObjectPtr<AActor> Goal;
+
+		/** Goal location when the corridors were computed */
+		FVector GoalLocation;
+
+		/** Paths from real navmesh queries, the navigation system invalidates them when the navmesh changes */
+		TArray<FNavPathSharedPtr> Corridors;
+
+		/** Enemies that asked for a path to this goal */
+		TArray<TWeakObjectPtr<AEnemy>> Followers;
+	};
+
+	/** Cache entries, one per goal actor (usually only the main character) */
+	TArray<FGoalPaths> GoalPaths;
+
+	/** Returns the cache entry for the goal, creating it when needed */
+	FGoalPaths& FindOrAddGoal(AActor* Goal);
+
+	/** Builds a path from Start that joins one of the corridors of the goal, returns null when no corridor is close enough */
+	FNavPathSharedPtr JoinCorridor(UWorld* World, const FGoalPaths& Entry, const FVector& Start) const;
+
+	/** Counters for the stats, reset every second */
+	int32 RequestsThisWindow;
+	int32 HitsThisWindow;
+	float WindowTime;
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyPoolSubsystem.h"
+#include "FirstProject.h"
+#include "Enemy.h"
+#include "AIController.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pooled Enemies"), STAT_PooledEnemies, STATGROUP_Enemies);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy Pool Hits"), STAT_EnemyPoolHits, STATGROUP_Enemies);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy Pool Misses"), STAT_EnemyPoolMisses, STATGROUP_Enemies);
+
+
+// Sets default values
+UEnemyPoolSubsystem::UEnemyPoolSubsystem()
+{
+	// Default, can be overridden in DefaultGame.ini
+	MaxPooledPerClass = 32;
+}
+
+// Returns the pool of the world the object lives in
+UEnemyPoolSubsystem* UEnemyPoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UEnemyPoolSubsystem>() : nullptr;
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UEnemyPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the world is torn down, the parked actors go away with the level
+void UEnemyPoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	SET_DWORD_STAT(STAT_PooledEnemies, 0);
+
+	Super::Deinitialize();
+}
+
+// Called by ASpawnVolume::SpawnOurActor_Implementation()
+AEnemy* UEnemyPoolSubsystem::AcquireEnemy(TSubclassOf<AEnemy> EnemyClass, const FVector& Location, const FRotator& Rotation)
+{
+	if (!EnemyClass) return nullptr;
+
+	if (FEnemyPoolList* Pool = Pools.Find(EnemyClass))
+	{
+		while (Pool->Enemies.Num() > 0)
+		{
+			AEnemy* Enemy = Pool->Enemies.Pop(false);
+			DEC_DWORD_STAT(STAT_PooledEnemies);
+			if (IsValid(Enemy)) // Parked enemies can still be destroyed by something else (level streaming for example)
+			{
+				INC_DWORD_STAT(STAT_EnemyPoolHits);
+				Enemy->ActivateFromPool(Location, Rotation);
+				return Enemy;
+			}
+		}
+	}
+
+	INC_DWORD_STAT(STAT_EnemyPoolMisses);
+	return SpawnEnemy(EnemyClass, Location, Rotation, FActorSpawnParameters());
+}
+
+// Called by AEnemy::Disappear()
+bool UEnemyPoolSubsystem::ReleaseEnemy(AEnemy* Enemy)
+{
+	if (!IsValid(Enemy)) return false;
+
+	FEnemyPoolList& Pool = Pools.FindOrAdd(Enemy->GetClass());
+	if (Pool.Enemies.Num() >= MaxPooledPerClass) return false;
+
+	Enemy->ParkInPool();
+	Pool.Enemies.Add(Enemy);
+	INC_DWORD_STAT(STAT_PooledEnemies);
+	return true;
+}
+
+// Called by ASpawnVolume::BeginPlay()
+void UEnemyPoolSubsystem::Prewarm(TSubclassOf<AEnemy> EnemyClass, int32 Count, const FVector& Location)
+{
+	if (!EnemyClass) return;
+
+	// Parked enemies have no collision, so they can all be spawned at the same place
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	Count = FMath::Min(Count, MaxPooledPerClass) - GetNumPooled(EnemyClass);
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AEnemy* Enemy = SpawnEnemy(EnemyClass, Location, FRotator(0.f), SpawnParams);
+		if (Enemy == nullptr) break;
+		if (!ReleaseEnemy(Enemy))
+		{
+			Enemy->Destroy();
+			break;
+		}
+	}
+}
+
+// Returns the number of enemies parked for the class
+int32 UEnemyPoolSubsystem::GetNumPooled(TSubclassOf<AEnemy> EnemyClass) const
+{
+	const FEnemyPoolList* Pool = Pools.Find(EnemyClass);
+	return Pool ? Pool->Enemies.Num() : 0;
+}
+
+// Called by AcquireEnemy() when the pool is empty and by Prewarm()
+AEnemy* UEnemyPoolSubsystem::SpawnEnemy(TSubclassOf<AEnemy> EnemyClass, const FVector& Location, const FRotator& Rotation, const FActorSpawnParameters& SpawnParams)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return nullptr;
+
+	AEnemy* Enemy = World->SpawnActor<AEnemy>(EnemyClass, Location, Rotation, SpawnParams);
+	if (Enemy)
+	{
+		// Spawn a default controller and set the AIController variable so the enemy can have the functionality from Enemy.h
+		Enemy->SpawnDefaultController();
+		AAIController* AICont = Cast<AAIController>(Enemy->GetController());
+		if (AICont)
+		{
+			Enemy->AIController = AICont;
+		}
+	}
+	return Enemy;
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that keeps dead enemies parked (hidden, without collision and without ticking) so the
+ * spawn volumes can reuse them instead of spawning new actors, one pool per enemy class.
+ * Avoids the SpawnActor/Destroy churn (and the garbage collection that comes with it) in wave maps.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyPoolSubsystem.generated.h"
+
+class AEnemy;
+struct FActorSpawnParameters;
+
+/** Parked enemies of one class */
+USTRUCT()
+struct FEnemyPoolList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AEnemy*> Enemies;
+};
+
+/**
+ * Settings are read from the [/Script/FirstProject.EnemyPoolSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UEnemyPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UEnemyPoolSubsystem();
+
+	/** Helper to get the pool of the world the object lives in */
+	static UEnemyPoolSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Only create the pool for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, forgets the parked enemies */
+	virtual void Deinitialize() override;
+
+	/** Returns an enemy of the class at the location, taken from the pool when possible or spawned otherwise */
+	AEnemy* AcquireEnemy(TSubclassOf<AEnemy> EnemyClass, const FVector& Location, const FRotator& Rotation);
+
+	/** Parks the enemy in the pool, returns false when the pool of its class is full and the enemy has to be destroyed */
+	bool ReleaseEnemy(AEnemy* Enemy);
+
+	/** Spawns enemies of the class and parks them right away, so the first waves don't have to spawn them
+	/* @param Count: number of enemies the pool of the class should hold */
+	void Prewarm(TSubclassOf<AEnemy> EnemyClass, int32 Count, const FVector& Location);
+
+	/** Number of enemies parked in the pool of the class */
+	int32 GetNumPooled(TSubclassOf<AEnemy> EnemyClass) const;
+
+	/** Max number of enemies parked per class */
+	UPROPERTY(config)
+	int32 MaxPooledPerClass;
+
+private:
+	/** Spawns a new enemy of the class with its AI controller */
+	AEnemy* SpawnEnemy(TSubclassOf<AEnemy> EnemyClass, const FVector& Location, const FRotator& Rotation, const FActorSpawnParameters& SpawnParams);
+
+	/** Parked enemies by class */
+	UPROPERTY()
+	TMap<UClass*, FEnemyPoolList> Pools;
+};
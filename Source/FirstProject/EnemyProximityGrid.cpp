@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyProximityGrid.h"
+
+// Sets default values
+FEnemyProximityGrid::FEnemyProximityGrid(float InCellSize)
+	: CellSize(InCellSize)
+	, InvCellSize(1.f / InCellSize)
+	, SourceLocations(nullptr)
+{
+}
+
+// Called by UEnemyManagerSubsystem once per frame, builds the buckets with a counting sort (no allocations once warmed up)
+void FEnemyProximityGrid::Rebuild(const TArray<FVector>& Locations)
+{
+	SourceLocations = &Locations;
+
+	const int32 NumLocations = Locations.Num();
+	BucketStart.Reset();
+	BucketStart.AddZeroed(NumBuckets + 1);
+	IndexBuckets.SetNumUninitialized(NumLocations, false);
+	SortedIndices.SetNumUninitialized(NumLocations, false);
+
+	// Counting how many locations land in every bucket
+	for (int32 Index = 0; Index < NumLocations; ++Index)
+	{
+		const FVector& Location = Locations[Index];
+		const int32 Bucket = HashCell(ToCell(Location.X), ToCell(Location.Y));
+		IndexBuckets[Index] = Bucket;
+		++BucketStart[Bucket + 1];
+	}
+
+	// Prefix sum so BucketStart[Bucket] is the first entry of the bucket
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		BucketStart[Bucket + 1] += BucketStart[Bucket];
+	}
+
+	// Placing every index in its bucket
+	BucketFill = BucketStart;
+	for (int32 Index = 0; Index < NumLocations; ++Index)
+	{
+		SortedIndices[BucketFill[IndexBuckets[Index]]++] = Index;
+	}
+}
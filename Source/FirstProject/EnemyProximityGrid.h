@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Uniform grid (spatial hash) over the enemy locations, rebuilt once per frame by the
+ * UEnemyManagerSubsystem. It answers "which enemies are inside this radius" by only looking
+ * at the cells the radius touches, instead of relying on physics overlap components.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FIRSTPROJECT_API FEnemyProximityGrid
+{
+public:
+	/** @param InCellSize: size in world units of every square cell (only X and Y are hashed) */
+	explicit FEnemyProximityGrid(float InCellSize = 400.f);
+
+	/** Rebuilds the grid from the enemy locations, Index in the array is the value returned by the queries */
+	void Rebuild(const TArray<FVector>& Locations);
+
+	/** Calls Func(Index, DistanceSquared) for every location inside the sphere of Radius around Center */
+	template<typename FunctorType>
+	void ForEachInRadius(const FVector& Center, float Radius, FunctorType&& Func) const;
+
+	/** Cell size used when hashing locations */
+	FORCEINLINE float GetCellSize() const { return CellSize; }
+
+private:
+	/** Number of hash buckets, must be a power of two */
+	static constexpr int32 NumBuckets = 1024;
+
+	/** Size of a cell and its inverse */
+	float CellSize;
+	float InvCellSize;
+
+	/** Locations used in the last Rebuild() */
+	const TArray<FVector>* SourceLocations;
+
+	/** First entry of every bucket inside SortedIndices (NumBuckets + 1 entries, counting sort layout) */
+	TArray<int32> BucketStart;
+
+	/** Location indices sorted by bucket */
+	TArray<int32> SortedIndices;
+
+	/** Scratch arrays reused between rebuilds to avoid allocations */
+	TArray<int32> IndexBuckets;
+	TArray<int32> BucketFill;
+
+	/** Cell coordinate of a world position */
+	FORCEINLINE int32 ToCell(float Value) const { return FMath::FloorToInt(Value * InvCellSize); }
+
+	/** Hash of a cell into a bucket */
+	FORCEINLINE static int32 HashCell(int32 X, int32 Y)
+	{
+		return (int32)(((uint32)X * 73856093u) ^ ((uint32)Y * 19349663u)) & (NumBuckets - 1);
+	}
+};
+
+template<typename FunctorType>
+void FEnemyProximityGrid::ForEachInRadius(const FVector& Center, float Radius, FunctorType&& Func) const
+{
+	if (SourceLocations == nullptr || SortedIndices.Num() == 0) return;
+
+	const TArray<FVector>& Locations = *SourceLocations;
+	const float RadiusSquared = Radius * Radius;
+
+	// Gathering the buckets touched by the radius, different cells can share a bucket so they are only visited once
+	TArray<int32, TInlineAllocator<64>> Buckets;
+	const int32 MinX = ToCell(Center.X - Radius);
+	const int32 MaxX = ToCell(Center.X + Radius);
+	const int32 MinY = ToCell(Center.Y - Radius);
+	const int32 MaxY = ToCell(Center.Y + Radius);
+	for (int32 X = MinX; X <= MaxX; ++X)
+	{
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			Buckets.AddUnique(HashCell(X, Y));
+		}
+	}
+
+	// Testing the real distance, this also filters the entries of other cells hashed into the same bucket
+	for (int32 Bucket : Buckets)
+	{
+		for (int32 Entry = BucketStart[Bucket]; Entry < BucketStart[Bucket + 1]; ++Entry)
+		{
+			const int32 Index = SortedIndices[Entry];
+			const float DistanceSquared = FVector::DistSquared(Locations[Index], Center);
+			if (DistanceSquared <= RadiusSquared)
+			{
+				Func(Index, DistanceSquared);
+			}
+		}
+	}
+}
@@ -6,6 +6,11 @@
 #include "Engine/World.h"
 #include "Sound/SoundCue.h"
 #include "Enemy.h"
+#include "Components/SphereComponent.h"
+#include "CombatQuerySubsystem.h"
+#include "DamageQueueSubsystem.h"
+#include "FXPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
 
 // Sets default values
 AExplosionHazard::AExplosionHazard()
@@ -13,6 +18,19 @@ AExplosionHazard::AExplosionHazard()
 	Damage = 15.f;
 }
 
+// Called when the game starts or when spawned
+void AExplosionHazard::BeginPlay()
+{
+	Super::BeginPlay();
+	// The hazard sphere is tested in the combat query batch instead of generating overlap events
+	UCombatQuerySubsystem* CombatQueries = UCombatQuerySubsystem::Get(this);
+	if (CombatQueries && UCombatQuerySubsystem::UseCombatQueries())
+	{
+		CollisionVolume->SetGenerateOverlapEvents(false);
+		CombatQueries->RegisterVolume(CollisionVolume, FOnCombatQueryHit::CreateUObject(this, &AExplosionHazard::CollisionVolumeOnQueryHit));
+	}
+}
+
 // Called when player enters the hazard sphere collision
 void AExplosionHazard::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
@@ -27,21 +45,39 @@ void AExplosionHazard::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent,
 		AEnemy* Enemy = Cast<AEnemy>(OtherActor); // Casting OtherActor to Enemy
 		if (MainCharacter || Enemy)
 		{
-			if (OverlapParticles)
-			{
-				UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), OverlapParticles, GetActorLocation(), FRotator(0.f), true);
-			}
-			if (OverlapSound)
-			{
-				UGameplayStatics::PlaySound2D(this, OverlapSound);
-			}
-			UGameplayStatics::ApplyDamage(OtherActor, Damage, nullptr, this, DamageTypeClass);
-
-			Destroy();
+			Explode(OtherActor);
 		}
 	} 
 }
 
+// Called by the combat query batch once per actor entering the hazard sphere
+void AExplosionHazard::CollisionVolumeOnQueryHit(const FHitResult& Hit)
+{
+	AActor* OtherActor = Hit.GetActor();
+	if (IsPendingKill()) return; // Already exploded on an actor delivered earlier in the same batch
+
+	if (Cast<AMainCharacter>(OtherActor) || Cast<AEnemy>(OtherActor))
+	{
+		Explode(OtherActor);
+	}
+}
+
+// Called when the player or an enemy enters the hazard sphere
+void AExplosionHazard::Explode(AActor* Victim)
+{
+	if (OverlapParticles)
+	{
+		UFXPoolSubsystem::SpawnEffectAtLocation(this, OverlapParticles, GetActorLocation());
+	}
+	if (OverlapSound)
+	{
+		UCombatAudioSubsystem::PlayCue(this, OverlapSound, GetActorLocation(), 1.5f);
+	}
+	UDamageQueueSubsystem::ApplyDamage(Victim, Damage, nullptr, this, DamageTypeClass, 0); // Applied at the end of the frame
+
+	Destroy();
+}
+
 // Called when player exists the hazard sphere collision
 void AExplosionHazard::OnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
@@ -21,6 +21,12 @@ class FIRSTPROJECT_API AExplosionHazard : public AItem
 public:
 	// Sets default values for this actor's properties
 	AExplosionHazard();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+public:
 	
 	/** Damage value to the player's health points when overlaping with this actor */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage")
@@ -30,6 +36,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
 	TSubclassOf<UDamageType> DamageTypeClass;
 
+	/** Called by UCombatQuerySubsystem when an actor enters the hazard sphere */
+	void CollisionVolumeOnQueryHit(const FHitResult& Hit);
+
+	/** Explodes on the player or an enemy, damaging it, and destroys the hazard */
+	void Explode(AActor* Victim);
+
 	/** Inherited from Item.h, called when player overlaps with Item actors */
 	virtual void OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult) override;
 	virtual void OnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex) override;
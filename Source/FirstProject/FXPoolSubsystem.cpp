@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FXPoolSubsystem.h"
+#include "FirstProject.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/WorldSettings.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Pooled Effects"), STAT_ActivePooledEffects, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX Pool Hits"), STAT_FXPoolHits, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX Pool Misses"), STAT_FXPoolMisses, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX Merged"), STAT_FXMerged, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX Restarted"), STAT_FXRestarted, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX Dropped"), STAT_FXDropped, STATGROUP_Gameplay);
+
+
+// Sets default values
+UFXPoolSubsystem::UFXPoolSubsystem()
+{
+	// Defaults, can be overridden in DefaultGame.ini
+	MaxActivePerEffect = 8;
+	MaxActiveEffects = 48;
+	MergeDistance = 50.f;
+	MergeTime = 0.1f;
+	NumActive = 0;
+}
+
+// Returns the effects pool of the world the object lives in
+UFXPoolSubsystem* UFXPoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UFXPoolSubsystem>() : nullptr;
+}
+
+// Called by the actors instead of UGameplayStatics::SpawnEmitterAtLocation()
+void UFXPoolSubsystem::SpawnEffectAtLocation(const UObject* WorldContextObject, UParticleSystem* Effect, const FVector& Location, const FRotator& Rotation)
+{
+	if (Effect == nullptr) return;
+
+	if (UFXPoolSubsystem* FXPool = Get(WorldContextObject))
+	{
+		FXPool->SpawnEffect(Effect, Location, Rotation);
+		return;
+	}
+	UGameplayStatics::SpawnEmitterAtLocation(WorldContextObject, Effect, Location, Rotation, true);
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UFXPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the world is torn down, the components go away with it
+void UFXPoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	NumActive = 0;
+	SET_DWORD_STAT(STAT_ActivePooledEffects, 0);
+
+	Super::Deinitialize();
+}
+
+// Called by SpawnEffectAtLocation()
+UParticleSystemComponent* UFXPoolSubsystem::SpawnEffect(UParticleSystem* Effect, const FVector& Location, const FRotator& Rotation)
+{
+	if (Effect == nullptr) return nullptr;
+
+	FFXPoolList& Pool = Pools.FindOrAdd(Effect);
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// Same effect at the same place in the same moment (several hits in one swing), one instance is enough
+	const float MergeDistanceSquared = MergeDistance * MergeDistance;
+	for (int32 i = Pool.Active.Num() - 1; i >= 0 && Now - Pool.ActiveStartTimes[i] <= MergeTime; --i)
+	{
+		if (FVector::DistSquared(Pool.Active[i]->GetComponentLocation(), Location) <= MergeDistanceSquared)
+		{
+			INC_DWORD_STAT(STAT_FXMerged);
+			return nullptr;
+		}
+	}
+
+	// Cap of the effect reached, the oldest instance is restarted here
+	if (Pool.Active.Num() >= MaxActivePerEffect && Pool.Active.Num() > 0)
+	{
+		UParticleSystemComponent* Oldest = Pool.Active[0];
+		Pool.Active.RemoveAt(0, 1, false);
+		Pool.ActiveStartTimes.RemoveAt(0, 1, false);
+		Pool.Active.Add(Oldest);
+		Pool.ActiveStartTimes.Add(Now);
+		PlayComponent(Oldest, Location, Rotation);
+		INC_DWORD_STAT(STAT_FXRestarted);
+		return Oldest;
+	}
+
+	// Global budget reached
+	if (NumActive >= MaxActiveEffects)
+	{
+		INC_DWORD_STAT(STAT_FXDropped);
+		return nullptr;
+	}
+
+	UParticleSystemComponent* Component = nullptr;
+	while (Pool.Free.Num() > 0 && Component == nullptr)
+	{
+		Component = Pool.Free.Pop(false);
+		if (!IsValid(Component)) Component = nullptr; // Destroyed with its owner (level streaming for example)
+	}
+	if (Component)
+	{
+		INC_DWORD_STAT(STAT_FXPoolHits);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_FXPoolMisses);
+		Component = CreateComponent(Effect);
+	}
+
+	Pool.Active.Add(Component);
+	Pool.ActiveStartTimes.Add(Now);
+	++NumActive;
+	SET_DWORD_STAT(STAT_ActivePooledEffects, NumActive);
+
+	PlayComponent(Component, Location, Rotation);
+	return Component;
+}
+
+// Called by the component when all its emitters finished
+void UFXPoolSubsystem::OnEffectFinished(UParticleSystemComponent* Component)
+{
+	FFXPoolList* Pool = Pools.Find(Component->Template);
+	if (Pool == nullptr) return;
+
+	const int32 Index = Pool->Active.Find(Component);
+	if (Index == INDEX_NONE) return;
+
+	Pool->Active.RemoveAt(Index, 1, false);
+	Pool->ActiveStartTimes.RemoveAt(Index, 1, false);
+	Pool->Free.Add(Component);
+	--NumActive;
+	SET_DWORD_STAT(STAT_ActivePooledEffects, NumActive);
+}
+
+// Same setup as UGameplayStatics::SpawnEmitterAtLocation(), without destroying the component when it finishes
+UParticleSystemComponent* UFXPoolSubsystem::CreateComponent(UParticleSystem* Effect)
+{
+	UWorld* World = GetWorld();
+	AWorldSettings* WorldSettings = World->GetWorldSettings();
+
+	UParticleSystemComponent* Component = NewObject<UParticleSystemComponent>(WorldSettings ? (UObject*)WorldSettings : (UObject*)World);
+	Component->bAutoDestroy = false;
+	Component->bAutoActivate = false;
+	Component->bAllowAnyoneToDestroyMe = true;
+	Component->SecondsBeforeInactive = 0.f;
+	Component->SetTemplate(Effect);
+	Component->SetUsingAbsoluteLocation(true);
+	Component->SetUsingAbsoluteRotation(true);
+	Component->SetUsingAbsoluteScale(true);
+	Component->OnSystemFinished.AddDynamic(this, &UFXPoolSubsystem::OnEffectFinished);
+	Component->RegisterComponentWithWorld(World);
+	return Component;
+}
+
+// Called for new, reused and restarted components
+void UFXPoolSubsystem::PlayComponent(UParticleSystemComponent* Component, const FVector& Location, const FRotator& Rotation)
+{
+	Component->SetWorldLocationAndRotation(Location, Rotation);
+	if (Component->IsActive())
+	{
+		Component->ResetParticles(); // Restarted instance, the particles it still had are dropped
+	}
+	Component->Activate(true);
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that plays the one shot particle effects (hits, pickups, explosions) from a pool of
+ * UParticleSystemComponents per UParticleSystem, instead of creating and destroying a component every time.
+ * Every effect has a cap of instances playing at the same time: a new instance close to one that just started
+ * is merged into it, otherwise the oldest instance is restarted at the new location. Past the global budget
+ * new effects are dropped.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FXPoolSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/** Components of one particle system */
+USTRUCT()
+struct FFXPoolList
+{
+	GENERATED_BODY()
+
+	/** Components ready to be played */
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Free;
+
+	/** Components playing, oldest first */
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Active;
+
+	/** World time every active component started at, same order as Active */
+	TArray<float> ActiveStartTimes;
+};
+
+/**
+ * Settings are read from the [/Script/FirstProject.FXPoolSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UFXPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UFXPoolSubsystem();
+
+	/** Helper to get the effects pool of the world the object lives in */
+	static UFXPoolSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Plays the effect from the pool of the world of the object, spawns a regular emitter when there is no pool (editor preview worlds) */
+	static void SpawnEffectAtLocation(const UObject* WorldContextObject, UParticleSystem* Effect, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	/** Only create the pool for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, forgets the pooled components */
+	virtual void Deinitialize() override;
+
+	/** Plays the effect at the location, returns the component used or nullptr when the effect was merged or dropped */
+	UParticleSystemComponent* SpawnEffect(UParticleSystem* Effect, const FVector& Location, const FRotator& Rotation);
+
+	/** Max instances of one effect playing at the same time */
+	UPROPERTY(config)
+	int32 MaxActivePerEffect;
+
+	/** Max instances of all the effects playing at the same time, new effects are dropped past it */
+	UPROPERTY(config)
+	int32 MaxActiveEffects;
+
+	/** An effect starting this close to an instance of the same effect that started less than MergeTime ago is merged into it */
+	UPROPERTY(config)
+	float MergeDistance;
+
+	UPROPERTY(config)
+	float MergeTime;
+
+private:
+	/** Bound to OnSystemFinished of every pooled component, puts the component back in the free list */
+	UFUNCTION()
+	void OnEffectFinished(UParticleSystemComponent* Component);
+
+	/** Creates a component for the effect, registered in the world but not playing */
+	UParticleSystemComponent* CreateComponent(UParticleSystem* Effect);
+
+	/** Moves the component to the location and starts it */
+	void PlayComponent(UParticleSystemComponent* Component, const FVector& Location, const FRotator& Rotation);
+
+	/** Pools by particle system */
+	UPROPERTY()
+	TMap<UParticleSystem*, FFXPoolList> Pools;
+
+	/** Components playing in every pool */
+	int32 NumActive;
+};
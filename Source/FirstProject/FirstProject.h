@@ -4,3 +4,11 @@
 
 #include "CoreMinimal.h"
 
+/** Stat group for the enemy systems, shown in game with the console command "stat Enemies" */
+DECLARE_STATS_GROUP(TEXT("Enemies"), STATGROUP_Enemies, STATCAT_Advanced);
+
+/** Stat group for the combat sounds (voices, culling, stealing), shown in game with "stat CombatAudio" next to "stat Audio" for the audio thread */
+DECLARE_STATS_GROUP(TEXT("CombatAudio"), STATGROUP_CombatAudio, STATCAT_Advanced);
+
+/** Stat group for the gameplay services shared by the actors (timers), shown in game with "stat Gameplay" */
+DECLARE_STATS_GROUP(TEXT("Gameplay"), STATGROUP_Gameplay, STATCAT_Advanced);
@@ -3,7 +3,7 @@
 
 #include "FloatingPlatform.h"
 #include "Components/StaticMeshComponent.h"
-#include "TimerManager.h"
+#include "GameplayTimerSubsystem.h"
 
 // Sets default values
 AFloatingPlatform::AFloatingPlatform()
@@ -31,7 +31,10 @@ void AFloatingPlatform::BeginPlay()
 	// Since EndPoint is local to the platform it needs to be changed to world location
 	EndPoint += StartPoint;
 	// Timer for the interpolation
-	GetWorldTimerManager().SetTimer(InterpTimer, this, &AFloatingPlatform::ToggleInterping, InterpTime);
+	if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+	{
+		GameplayTimers->SetTimer(InterpTimer, this, &AFloatingPlatform::ToggleInterping, InterpTime);
+	}
 	// Initializing distance, since the points are vectors Size() is used to get a float
 	Distance = (EndPoint - StartPoint).Size();
 	
@@ -53,7 +56,10 @@ void AFloatingPlatform::Tick(float DeltaTime)
 		if (Distance - DistanceTraveled <= 1.f) // Preparing the platform to interpolate back to start point
 		{
 			ToggleInterping();
-			GetWorldTimerManager().SetTimer(InterpTimer, this, &AFloatingPlatform::ToggleInterping, InterpTime);
+			if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+			{
+				GameplayTimers->SetTimer(InterpTimer, this, &AFloatingPlatform::ToggleInterping, InterpTime);
+			}
 			SwapVectors(StartPoint, EndPoint);
 		}
 	}
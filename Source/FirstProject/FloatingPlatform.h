@@ -9,6 +9,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "GameplayTimerWheel.h"
 #include "FloatingPlatform.generated.h"
 
 UCLASS()
@@ -34,8 +35,8 @@ public:
 	/** Time to wait between interpolations */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Platform)
 	float InterpTime;
-	/** TimerHandle to have pauses between the interpolations */
-	FTimerHandle InterpTimer;
+	/** TimerHandle to have pauses between the interpolations, set in the gameplay timer wheel */
+	FGameplayTimerHandle InterpTimer;
 	/** Boolean to know if the platform is currently interpolating */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Platform)
 	bool bInterping;
@@ -4,6 +4,7 @@
 #include "FloorSwitch.h"
 #include "Components/BoxComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "GameplayTimerSubsystem.h"
 
 
 // Sets default values
@@ -69,7 +70,10 @@ void AFloorSwitch::OnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor
 {
 	UE_LOG(LogTemp, Warning, TEXT("Overlap End.")); // Check to verify if the player is no longer overlapping with the box component
 	if (bCharacterOnSwitch) bCharacterOnSwitch = false; // Player stepped out of the switch
-	GetWorldTimerManager().SetTimer(SwitchHandle, this, &AFloorSwitch::CloseDoor, SwitchTimer); // Timer for the door to close after the time set by SwitchTimer
+	if (UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this))
+	{
+		GameplayTimers->SetTimer(SwitchHandle, this, &AFloorSwitch::CloseDoor, SwitchTimer); // Timer for the door to close after the time set by SwitchTimer
+	}
 }
 
 // Called when player activates the floor switch
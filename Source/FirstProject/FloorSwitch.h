@@ -10,6 +10,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "GameplayTimerWheel.h"
 #include "FloorSwitch.generated.h"
 
 UCLASS()
@@ -41,8 +42,8 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = FloorSwitch)
 	FVector InitialSwitchLocation;
 
-	/** TimerHandle object to call GetWorldTimerManager().SetTimer() in OnOverlapEnd() */
-	FTimerHandle SwitchHandle;
+	/** TimerHandle object for the gameplay timer set in OnOverlapEnd() */
+	FGameplayTimerHandle SwitchHandle;
 
 	/** Timer for the floor swith */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = FloorSwitch)
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameplayTimerSubsystem.h"
+#include "FirstProject.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Gameplay Timer Wheel"), STAT_GameplayTimerWheel, STATGROUP_Gameplay);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Gameplay Timers"), STAT_ActiveGameplayTimers, STATGROUP_Gameplay);
+
+#if !UE_BUILD_SHIPPING
+/** Compares the gameplay timer wheel against FTimerManager, both advanced in the same 1/60 s steps */
+static void BenchmarkTimers(const TArray<FString>& Args)
+{
+	int32 NumTimers = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0;
+	if (NumTimers <= 0) NumTimers = 10000;
+
+	// Same random delays for both timer services, between 0.1 and 10 seconds
+	FRandomStream Random(1234);
+	TArray<float> Delays;
+	Delays.SetNumUninitialized(NumTimers);
+	for (float& Delay : Delays)
+	{
+		Delay = Random.FRandRange(0.1f, 10.f);
+	}
+
+	// Frames of 1/60 s until every timer fired
+	const float StepTime = 1.f / 60.f;
+	const int32 NumSteps = FMath::CeilToInt(11.f / StepTime);
+
+	int32 WheelFired = 0;
+	int32 ManagerFired = 0;
+	double StartTime;
+
+	// Timing wheel, a standalone wheel so the timers of the game are not affected
+	FGameplayTimerWheel TimerWheel;
+	TArray<FGameplayTimerHandle> WheelHandles;
+	WheelHandles.SetNum(NumTimers);
+	const FTimerDelegate WheelDelegate = FTimerDelegate::CreateLambda([&WheelFired]() { ++WheelFired; });
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumTimers; ++i)
+	{
+		TimerWheel.SetTimer(WheelHandles[i], WheelDelegate, Delays[i]);
+	}
+	const double WheelSetMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumTimers; i += 2) // Clearing half of the timers
+	{
+		TimerWheel.ClearTimer(WheelHandles[i]);
+	}
+	const double WheelClearMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		TimerWheel.Advance(StepTime);
+	}
+	const double WheelFireMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	// FTimerManager, also a standalone one
+	FTimerManager TimerManager;
+	TArray<FTimerHandle> ManagerHandles;
+	ManagerHandles.SetNum(NumTimers);
+	const FTimerDelegate ManagerDelegate = FTimerDelegate::CreateLambda([&ManagerFired]() { ++ManagerFired; });
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumTimers; ++i)
+	{
+		TimerManager.SetTimer(ManagerHandles[i], ManagerDelegate, Delays[i], false);
+	}
+	const double ManagerSetMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumTimers; i += 2)
+	{
+		TimerManager.ClearTimer(ManagerHandles[i]);
+	}
+	const double ManagerClearMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	// FTimerManager only ticks once per engine frame, the frame counter is stepped with it and put back afterwards
+	const uint64 FrameCounter = GFrameCounter;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		++GFrameCounter;
+		TimerManager.Tick(StepTime);
+	}
+	const double ManagerFireMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	GFrameCounter = FrameCounter;
+
+	const FString WheelResult = FString::Printf(TEXT("Timer wheel (%d timers): set %.3f ms, clear half %.3f ms, fire %d in %d frames %.3f ms (%.4f ms per frame)"),
+		NumTimers, WheelSetMs, WheelClearMs, WheelFired, NumSteps, WheelFireMs, WheelFireMs / NumSteps);
+	const FString ManagerResult = FString::Printf(TEXT("FTimerManager (%d timers): set %.3f ms, clear half %.3f ms, fire %d in %d frames %.3f ms (%.4f ms per frame)"),
+		NumTimers, ManagerSetMs, ManagerClearMs, ManagerFired, NumSteps, ManagerFireMs, ManagerFireMs / NumSteps);
+	UE_LOG(LogTemp, Log, TEXT("%s"), *WheelResult);
+	UE_LOG(LogTemp, Log, TEXT("%s"), *ManagerResult);
+	if (GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Cyan, WheelResult);
+		GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Cyan, ManagerResult);
+	}
+}
+
+static FAutoConsoleCommand BenchmarkTimersCommand(
+	TEXT("fp.BenchmarkTimers"),
+	TEXT("Compares the gameplay timer wheel against FTimerManager with <NumTimers> active timers (10000 by default),\n")
+	TEXT("prints the time to set, clear and fire them over 1/60 s frames"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkTimers));
+#endif
+
+
+// Sets default values
+UGameplayTimerSubsystem::UGameplayTimerSubsystem()
+{
+	// Default, can be overridden in DefaultGame.ini
+	TimerResolution = 1.f / 60.f;
+}
+
+// Returns the timers of the world the object lives in
+UGameplayTimerSubsystem* UGameplayTimerSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UGameplayTimerSubsystem>() : nullptr;
+}
+
+// Called by the engine before creating the subsystem for a world
+bool UGameplayTimerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld();
+}
+
+// Called when the subsystem is created for the world
+void UGameplayTimerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TimerWheel.SetTickResolution(TimerResolution);
+}
+
+// Called when the world is torn down
+void UGameplayTimerSubsystem::Deinitialize()
+{
+	TimerWheel.Reset();
+
+	Super::Deinitialize();
+}
+
+// Only tick for the real subsystem instance
+bool UGameplayTimerSubsystem::IsTickable() const
+{
+	return !IsTemplate();
+}
+
+// Stat used by the engine to time the tickable object
+TStatId UGameplayTimerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayTimerSubsystem, STATGROUP_Tickables);
+}
+
+// Called every frame, fires the timers that are due
+void UGameplayTimerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GameplayTimerWheel);
+
+	TimerWheel.Advance(DeltaTime);
+
+	SET_DWORD_STAT(STAT_ActiveGameplayTimers, TimerWheel.GetNumActiveTimers());
+}
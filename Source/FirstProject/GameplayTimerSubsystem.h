@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * World subsystem that owns the FGameplayTimerWheel used by the gameplay actors (enemies, platforms, switches)
+ * instead of FTimerManager. Advanced with the world delta time, so it follows pause and time dilation the same way.
+ * The console command fp.BenchmarkTimers compares the wheel against FTimerManager (not in shipping builds).
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "GameplayTimerWheel.h"
+#include "GameplayTimerSubsystem.generated.h"
+
+/**
+ * Settings are read from the [/Script/FirstProject.GameplayTimerSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UGameplayTimerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UGameplayTimerSubsystem();
+
+	/** Helper to get the timers of the world the object lives in */
+	static UGameplayTimerSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Only create the subsystem for game worlds (no editor preview worlds) */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	/** Inherited from UWorldSubsystem, sets the wheel resolution from the config */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Inherited from UWorldSubsystem, drops every timer */
+	virtual void Deinitialize() override;
+
+	/** Inherited from FTickableGameObject, advances the wheel */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Same as FTimerManager::SetTimer(), the timer is skipped when the object is destroyed before it fires */
+	template<class UserClass>
+	void SetTimer(FGameplayTimerHandle& InOutHandle, UserClass* Object, typename FTimerDelegate::TUObjectMethodDelegate<UserClass>::FMethodPtr Method, float Rate, bool bLoop = false, float FirstDelay = -1.f)
+	{
+		TimerWheel.SetTimer(InOutHandle, FTimerDelegate::CreateUObject(Object, Method), Rate, bLoop, FirstDelay);
+	}
+
+	/** Setters/Getters forwarded to the wheel */
+	FORCEINLINE void SetTimer(FGameplayTimerHandle& InOutHandle, const FTimerDelegate& Delegate, float Rate, bool bLoop = false, float FirstDelay = -1.f) { TimerWheel.SetTimer(InOutHandle, Delegate, Rate, bLoop, FirstDelay); }
+	FORCEINLINE void ClearTimer(FGameplayTimerHandle& InOutHandle) { TimerWheel.ClearTimer(InOutHandle); }
+	FORCEINLINE bool IsTimerActive(const FGameplayTimerHandle& Handle) const { return TimerWheel.IsTimerActive(Handle); }
+	FORCEINLINE float GetTimerRemaining(const FGameplayTimerHandle& Handle) const { return TimerWheel.GetTimerRemaining(Handle); }
+
+	/** Length of a wheel tick in seconds, timers fire on the first wheel tick after their time */
+	UPROPERTY(config)
+	float TimerResolution;
+
+private:
+	FGameplayTimerWheel TimerWheel;
+};
@@ -0,0 +1,241 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameplayTimerWheel.h"
+
+
+// Sets default values
+FGameplayTimerWheel::FGameplayTimerWheel(float InTickResolution)
+{
+	FreeHead = INDEX_NONE;
+	CurrentTick = 0;
+	PendingTime = 0.f;
+	TickResolution = FMath::Max(InTickResolution, KINDA_SMALL_NUMBER);
+	NumActive = 0;
+	for (int32& Head : SlotHeads)
+	{
+		Head = INDEX_NONE;
+	}
+}
+
+// Called by the timer subsystem when the config is loaded
+void FGameplayTimerWheel::SetTickResolution(float InTickResolution)
+{
+	TickResolution = FMath::Max(InTickResolution, KINDA_SMALL_NUMBER);
+}
+
+// Adds the timer to the wheel, O(1)
+void FGameplayTimerWheel::SetTimer(FGameplayTimerHandle& InOutHandle, const FTimerDelegate& Delegate, float Rate, bool bLoop, float FirstDelay)
+{
+	ClearTimer(InOutHandle);
+
+	// Same as FTimerManager, a rate of 0 or less just clears the timer
+	if (Rate <= 0.f) return;
+
+	// Taking a node from the free list, or adding a new one
+	int32 Index = FreeHead;
+	if (Index != INDEX_NONE)
+	{
+		FreeHead = Nodes[Index].Next;
+	}
+	else
+	{
+		Index = Nodes.AddDefaulted();
+		Nodes[Index].Serial = 1;
+	}
+
+	FTimerNode& Node = Nodes[Index];
+	Node.Delegate = Delegate;
+	Node.IntervalTicks = ToTicks(Rate);
+	Node.ExpireTick = CurrentTick + ToTicks(FirstDelay >= 0.f ? FirstDelay : Rate);
+	Node.bLoop = bLoop;
+	Node.bActive = true;
+	Link(Index);
+	++NumActive;
+
+	InOutHandle.Index = Index;
+	InOutHandle.Serial = Node.Serial;
+}
+
+// Removes the timer from its slot, O(1)
+void FGameplayTimerWheel::ClearTimer(FGameplayTimerHandle& InOutHandle)
+{
+	if (IsTimerActive(InOutHandle))
+	{
+		// Nodes in the firing batch are not linked, the batch skips them once they are freed
+		if (Nodes[InOutHandle.Index].Slot != INDEX_NONE)
+		{
+			Unlink(InOutHandle.Index);
+		}
+		FreeNode(InOutHandle.Index);
+	}
+	InOutHandle.Invalidate();
+}
+
+// Checks the serial of the node, the node may have been reused by another timer
+bool FGameplayTimerWheel::IsTimerActive(const FGameplayTimerHandle& Handle) const
+{
+	return Nodes.IsValidIndex(Handle.Index) && Nodes[Handle.Index].bActive && Nodes[Handle.Index].Serial == Handle.Serial;
+}
+
+// Remaining time, rounded to the wheel ticks
+float FGameplayTimerWheel::GetTimerRemaining(const FGameplayTimerHandle& Handle) const
+{
+	if (!IsTimerActive(Handle)) return -1.f;
+
+	const FTimerNode& Node = Nodes[Handle.Index];
+	return FMath::Max((float)(Node.ExpireTick - CurrentTick) * TickResolution - PendingTime, 0.f);
+}
+
+// Called every frame by the timer subsystem
+void FGameplayTimerWheel::Advance(float DeltaTime)
+{
+	PendingTime += DeltaTime;
+	while (PendingTime >= TickResolution)
+	{
+		PendingTime -= TickResolution;
+		ProcessTick();
+	}
+}
+
+// Drops every timer, the handles pointing to them stop being active
+void FGameplayTimerWheel::Reset()
+{
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		if (Nodes[Index].bActive)
+		{
+			Nodes[Index].Slot = INDEX_NONE;
+			FreeNode(Index);
+		}
+	}
+	for (int32& Head : SlotHeads)
+	{
+		Head = INDEX_NONE;
+	}
+}
+
+// Rounds up so a timer never fires before its time
+uint32 FGameplayTimerWheel::ToTicks(float Seconds) const
+{
+	const double Ticks = FMath::CeilToDouble((double)Seconds / TickResolution);
+	return (uint32)FMath::Clamp(Ticks, 1.0, (double)MAX_uint32);
+}
+
+// Picks the level from the distance to the expire tick, the slot inside the level from the expire tick bits of that level
+void FGameplayTimerWheel::Link(int32 Index)
+{
+	FTimerNode& Node = Nodes[Index];
+	const uint64 Delta = Node.ExpireTick - CurrentTick;
+
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delta >= (1ull << (SlotBits * (Level + 1))))
+	{
+		++Level;
+	}
+	const int32 Slot = Level * NumSlots + (int32)((Node.ExpireTick >> (SlotBits * Level)) & SlotMask);
+
+	Node.Slot = Slot;
+	Node.Prev = INDEX_NONE;
+	Node.Next = SlotHeads[Slot];
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Index;
+	}
+	SlotHeads[Slot] = Index;
+}
+
+// Fixes the links of the neighbours, or the head of the slot
+void FGameplayTimerWheel::Unlink(int32 Index)
+{
+	FTimerNode& Node = Nodes[Index];
+	if (Node.Prev != INDEX_NONE)
+	{
+		Nodes[Node.Prev].Next = Node.Next;
+	}
+	else
+	{
+		SlotHeads[Node.Slot] = Node.Next;
+	}
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Node.Prev;
+	}
+	Node.Slot = INDEX_NONE;
+	Node.Prev = INDEX_NONE;
+	Node.Next = INDEX_NONE;
+}
+
+// The node goes to the head of the free list
+void FGameplayTimerWheel::FreeNode(int32 Index)
+{
+	FTimerNode& Node = Nodes[Index];
+	Node.Delegate.Unbind();
+	Node.bActive = false;
+	++Node.Serial;
+	Node.Next = FreeHead;
+	FreeHead = Index;
+	--NumActive;
+}
+
+// Called by ProcessTick() when the level below wraps around
+void FGameplayTimerWheel::Cascade(int32 Level)
+{
+	const int32 Slot = Level * NumSlots + (int32)((CurrentTick >> (SlotBits * Level)) & SlotMask);
+	int32 Index = SlotHeads[Slot];
+	SlotHeads[Slot] = INDEX_NONE;
+	while (Index != INDEX_NONE)
+	{
+		const int32 Next = Nodes[Index].Next;
+		Link(Index); // Closer to its expire tick now, so it lands in a lower level
+		Index = Next;
+	}
+}
+
+// Called by Advance() once per elapsed tick
+void FGameplayTimerWheel::ProcessTick()
+{
+	++CurrentTick;
+
+	// Cascading from the lowest level up, the higher levels only wrap when every level below wrapped
+	for (int32 Level = 1; Level < NumLevels; ++Level)
+	{
+		if ((CurrentTick & ((1ull << (SlotBits * Level)) - 1)) != 0) break;
+		Cascade(Level);
+	}
+
+	// Detaching the whole due slot first, the callbacks can set and clear timers (even ones in this batch)
+	const int32 Slot = (int32)(CurrentTick & SlotMask);
+	int32 Index = SlotHeads[Slot];
+	if (Index == INDEX_NONE) return;
+
+	SlotHeads[Slot] = INDEX_NONE;
+	TArray<TPair<int32, uint32>, TInlineAllocator<64>> Batch;
+	while (Index != INDEX_NONE)
+	{
+		FTimerNode& Node = Nodes[Index];
+		const int32 Next = Node.Next;
+		Node.Slot = INDEX_NONE;
+		Node.Prev = INDEX_NONE;
+		Node.Next = INDEX_NONE;
+		Batch.Add(TPair<int32, uint32>(Index, Node.Serial));
+		Index = Next;
+	}
+
+	for (const TPair<int32, uint32>& Entry : Batch)
+	{
+		if (!Nodes[Entry.Key].bActive || Nodes[Entry.Key].Serial != Entry.Value) continue; // Cleared by an earlier callback
+
+		// Looping timers are linked again before the call so the callback can clear them
+		FTimerDelegate Delegate = Nodes[Entry.Key].Delegate;
+		if (Nodes[Entry.Key].bLoop)
+		{
+			Nodes[Entry.Key].ExpireTick = CurrentTick + Nodes[Entry.Key].IntervalTicks;
+			Link(Entry.Key);
+		}
+		else
+		{
+			FreeNode(Entry.Key);
+		}
+		Delegate.ExecuteIfBound();
+	}
+}
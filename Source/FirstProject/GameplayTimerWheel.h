@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Hierarchical timing wheel for gameplay timers. Time is split in ticks of TickResolution seconds and the timers
+ * are stored in 4 wheels of 256 slots (each wheel covers 256 times the range of the one below), so adding and
+ * clearing a timer is O(1) and every slot that comes due is fired as one batch.
+ * Timers far in the future cascade down to the lower wheels as time goes by.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+/** Handle to a timer of a FGameplayTimerWheel, the wheel invalidates it when the timer is cleared or fires for the last time */
+struct FIRSTPROJECT_API FGameplayTimerHandle
+{
+	FGameplayTimerHandle()
+		: Index(INDEX_NONE)
+		, Serial(0)
+	{
+	}
+
+	FORCEINLINE bool IsValid() const { return Index != INDEX_NONE; }
+	FORCEINLINE void Invalidate() { Index = INDEX_NONE; Serial = 0; }
+
+private:
+	friend class FGameplayTimerWheel;
+
+	/** Node of the timer inside the wheel */
+	int32 Index;
+
+	/** Serial of the node when the timer was set, nodes are reused so old handles don't match anymore */
+	uint32 Serial;
+};
+
+class FIRSTPROJECT_API FGameplayTimerWheel
+{
+public:
+	/** @param InTickResolution: length of a wheel tick in seconds, timers fire on the first tick after their time */
+	explicit FGameplayTimerWheel(float InTickResolution = 1.f / 60.f);
+
+	/** Sets a timer, clearing the one the handle was pointing to
+	/* @param Rate: seconds between the calls (or until the only call when not looping)
+	/* @param FirstDelay: seconds until the first call, Rate is used when negative */
+	void SetTimer(FGameplayTimerHandle& InOutHandle, const FTimerDelegate& Delegate, float Rate, bool bLoop = false, float FirstDelay = -1.f);
+
+	/** Removes the timer and invalidates the handle */
+	void ClearTimer(FGameplayTimerHandle& InOutHandle);
+
+	/** True while the timer of the handle is waiting to fire */
+	bool IsTimerActive(const FGameplayTimerHandle& Handle) const;
+
+	/** Seconds until the timer fires, -1 when the timer is not active */
+	float GetTimerRemaining(const FGameplayTimerHandle& Handle) const;
+
+	/** Moves the wheel forward and fires the timers that came due, slot by slot */
+	void Advance(float DeltaTime);
+
+	/** Removes every timer */
+	void Reset();
+
+	/** Number of timers waiting to fire */
+	FORCEINLINE int32 GetNumActiveTimers() const { return NumActive; }
+
+	/** Length of a wheel tick in seconds */
+	FORCEINLINE float GetTickResolution() const { return TickResolution; }
+	void SetTickResolution(float InTickResolution);
+
+private:
+	enum
+	{
+		NumLevels = 4,
+		SlotBits = 8,
+		NumSlots = 1 << SlotBits,
+		SlotMask = NumSlots - 1
+	};
+
+	/** One timer, nodes are linked in a doubly linked list per slot so they can be removed in O(1) */
+	struct FTimerNode
+	{
+		FTimerDelegate Delegate;
+		uint64 ExpireTick;
+		uint32 IntervalTicks;
+		uint32 Serial;
+		int32 Prev;
+		int32 Next;
+		/** Slot the node is linked in (Level * NumSlots + Slot), INDEX_NONE while firing or free */
+		int32 Slot;
+		bool bLoop;
+		bool bActive;
+	};
+
+	/** Timer nodes, free nodes are chained through Next starting at FreeHead */
+	TArray<FTimerNode> Nodes;
+	int32 FreeHead;
+
+	/** First node of every slot of every level */
+	int32 SlotHeads[NumLevels * NumSlots];
+
+	/** Last tick processed */
+	uint64 CurrentTick;
+
+	/** Time not consumed by a whole tick yet */
+	float PendingTime;
+
+	float TickResolution;
+	int32 NumActive;
+
+	/** Converts seconds to wheel ticks, at least one tick */
+	uint32 ToTicks(float Seconds) const;
+
+	/** Links the node in the slot matching its expire tick */
+	void Link(int32 Index);
+
+	/** Removes the node from its slot */
+	void Unlink(int32 Index);
+
+	/** Returns the node to the free list and bumps its serial so the handles to it stop working */
+	void FreeNode(int32 Index);
+
+	/** Moves the timers of the slot of Level that is now due down to the lower levels */
+	void Cascade(int32 Level);
+
+	/** Processes one tick, cascading the upper levels when the lower ones wrap around and firing the due slot */
+	void ProcessTick();
+};
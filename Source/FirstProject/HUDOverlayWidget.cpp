@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HUDOverlayWidget.h"
+#include "HUDViewModel.h"
+#include "Components/ProgressBar.h"
+#include "Components/TextBlock.h"
+
+
+// Called by AMainPlayerController after creating the overlay
+void UHUDOverlayWidget::SetViewModel(UHUDViewModel* InViewModel)
+{
+	if (ViewModel && ViewModel != InViewModel)
+	{
+		ViewModel->OnStatChanged.RemoveDynamic(this, &UHUDOverlayWidget::ViewModelStatChanged);
+	}
+	ViewModel = InViewModel;
+	if (ViewModel == nullptr) return;
+
+	ViewModel->OnStatChanged.AddUniqueDynamic(this, &UHUDOverlayWidget::ViewModelStatChanged);
+
+	// Current values, the next ones come with the changes
+	ViewModelStatChanged(ECharacterAttribute::ECA_Health, ViewModel->Health);
+	ViewModelStatChanged(ECharacterAttribute::ECA_Stamina, ViewModel->Stamina);
+	ViewModelStatChanged(ECharacterAttribute::ECA_Coins, (float)ViewModel->Coins);
+}
+
+// Called when the widget is added to the viewport
+void UHUDOverlayWidget::NativeConstruct()
+{
+	Super::NativeConstruct();
+
+	// Added again after being removed, the view-model kept changing in between
+	if (ViewModel)
+	{
+		SetViewModel(ViewModel);
+	}
+}
+
+// Called when the widget is removed from the viewport, it keeps its view-model for when it is added again
+void UHUDOverlayWidget::NativeDestruct()
+{
+	if (ViewModel)
+	{
+		ViewModel->OnStatChanged.RemoveDynamic(this, &UHUDOverlayWidget::ViewModelStatChanged);
+	}
+
+	Super::NativeDestruct();
+}
+
+// Called by the view-model once for every stat that changed
+void UHUDOverlayWidget::ViewModelStatChanged(ECharacterAttribute Attribute, float Value)
+{
+	switch (Attribute)
+	{
+	case ECharacterAttribute::ECA_Health:
+	case ECharacterAttribute::ECA_MaxHealth:
+		if (HealthProgressBar)
+		{
+			HealthProgressBar->SetPercent(ViewModel->GetHealthPercent());
+		}
+		break;
+
+	case ECharacterAttribute::ECA_Stamina:
+	case ECharacterAttribute::ECA_MaxStamina:
+		if (StaminaProgressBar)
+		{
+			StaminaProgressBar->SetPercent(ViewModel->GetStaminaPercent());
+		}
+		break;
+
+	case ECharacterAttribute::ECA_Coins:
+		if (CoinsText)
+		{
+			CoinsText->SetText(FText::AsNumber(ViewModel->Coins));
+		}
+		break;
+
+	default:
+		;
+	}
+
+	OnStatChanged(Attribute, Value);
+}
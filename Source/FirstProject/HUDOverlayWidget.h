@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Native base class for the HUD_Overlay Widget Blueprint. The bars and the coins text are set from the UHUDViewModel
+ * when a stat changes instead of through property bindings, and the widget never ticks, so with the overlay inside
+ * an Invalidation Box in the Widget Blueprint Slate can reuse the cached overlay on the frames where nothing changed.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "CharacterAttributes.h"
+#include "HUDOverlayWidget.generated.h"
+
+class UHUDViewModel;
+class UProgressBar;
+class UTextBlock;
+
+/**
+ *
+ */
+UCLASS(meta = (DisableNativeTick))
+class FIRSTPROJECT_API UHUDOverlayWidget : public UUserWidget
+{
+	GENERATED_BODY()
+public:
+	/** Listens to the view-model (stops listening to the previous one) and shows its current values */
+	void SetViewModel(UHUDViewModel* InViewModel);
+
+	/** View-model the values come from */
+	UPROPERTY(BlueprintReadOnly, Category = "HUD")
+	UHUDViewModel* ViewModel;
+
+	/** Widgets of the Widget Blueprint with these names, set by the view-model changes (no property binding needed) */
+	UPROPERTY(BlueprintReadOnly, Category = "HUD", meta = (BindWidgetOptional))
+	UProgressBar* HealthProgressBar;
+
+	UPROPERTY(BlueprintReadOnly, Category = "HUD", meta = (BindWidgetOptional))
+	UProgressBar* StaminaProgressBar;
+
+	UPROPERTY(BlueprintReadOnly, Category = "HUD", meta = (BindWidgetOptional))
+	UTextBlock* CoinsText;
+
+	/** Called after a stat changed and the widgets above were updated, for what the blueprint does on top (colors, animations) */
+	UFUNCTION(BlueprintImplementableEvent, Category = "HUD")
+	void OnStatChanged(ECharacterAttribute Attribute, float Value);
+
+protected:
+	/** Inherited from UUserWidget, listen to the view-model while the widget is in the viewport */
+	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
+
+private:
+	/** Bound to ViewModel->OnStatChanged */
+	UFUNCTION()
+	void ViewModelStatChanged(ECharacterAttribute Attribute, float Value);
+};
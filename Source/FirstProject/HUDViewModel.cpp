@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HUDViewModel.h"
+#include "FirstProject.h"
+#include "MainCharacter.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("HUD Stat Pushes"), STAT_HUDStatPushes, STATGROUP_Gameplay);
+
+
+// Sets default values
+UHUDViewModel::UHUDViewModel()
+{
+	Health = 0.f;
+	MaxHealth = 0.f;
+	Stamina = 0.f;
+	MaxStamina = 0.f;
+	Coins = 0;
+}
+
+// Called by AMainPlayerController when it gets its character
+void UHUDViewModel::SetCharacter(AMainCharacter* Character)
+{
+	if (BoundCharacter.Get() == Character) return;
+
+	if (AMainCharacter* PreviousCharacter = BoundCharacter.Get())
+	{
+		PreviousCharacter->Attributes.OnAttributeChanged.Remove(AttributeChangedHandle);
+	}
+	AttributeChangedHandle.Reset();
+	BoundCharacter = Character;
+	if (Character == nullptr) return;
+
+	AttributeChangedHandle = Character->Attributes.OnAttributeChanged.AddUObject(this, &UHUDViewModel::AttributeChanged);
+
+	// Current values, the next ones come with the attribute changes
+	AttributeChanged(ECharacterAttribute::ECA_Health, Character->Attributes.Get(ECharacterAttribute::ECA_Health));
+	AttributeChanged(ECharacterAttribute::ECA_MaxHealth, Character->Attributes.Get(ECharacterAttribute::ECA_MaxHealth));
+	AttributeChanged(ECharacterAttribute::ECA_Stamina, Character->Attributes.Get(ECharacterAttribute::ECA_Stamina));
+	AttributeChanged(ECharacterAttribute::ECA_MaxStamina, Character->Attributes.Get(ECharacterAttribute::ECA_MaxStamina));
+	AttributeChanged(ECharacterAttribute::ECA_Coins, Character->Attributes.Get(ECharacterAttribute::ECA_Coins));
+}
+
+// Called by the character when it flushes its attributes, only for the ones that changed
+void UHUDViewModel::AttributeChanged(ECharacterAttribute Attribute, float Value)
+{
+	switch (Attribute)
+	{
+	case ECharacterAttribute::ECA_Health:
+		Health = Value;
+		break;
+
+	case ECharacterAttribute::ECA_MaxHealth:
+		MaxHealth = Value;
+		break;
+
+	case ECharacterAttribute::ECA_Stamina:
+		Stamina = Value;
+		break;
+
+	case ECharacterAttribute::ECA_MaxStamina:
+		MaxStamina = Value;
+		break;
+
+	case ECharacterAttribute::ECA_Coins:
+		Coins = FMath::RoundToInt(Value);
+		break;
+
+	default: // Not shown by the HUD (move speed)
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_HUDStatPushes);
+	OnStatChanged.Broadcast(Attribute, Value);
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Native view-model of the HUD overlay. It listens to the attribute changes of the main character, so the values
+ * are only pushed to the HUD widgets when a stat changes instead of the widgets reading the character through
+ * property bindings every frame.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "CharacterAttributes.h"
+#include "HUDViewModel.generated.h"
+
+class AMainCharacter;
+
+/** Stat of the HUD that changed and its new value */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnHUDStatChanged, ECharacterAttribute, Attribute, float, Value);
+
+/**
+ *
+ */
+UCLASS(BlueprintType)
+class FIRSTPROJECT_API UHUDViewModel : public UObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UHUDViewModel();
+
+	/** Listens to the attributes of the character (stops listening to the previous one), every value is pushed right away */
+	void SetCharacter(AMainCharacter* Character);
+
+	/** Values shown by the HUD */
+	UPROPERTY(BlueprintReadOnly, Category = "HUD")
+	float Health;
+	UPROPERTY(BlueprintReadOnly, Category = "HUD")
+	float MaxHealth;
+	UPROPERTY(BlueprintReadOnly, Category = "HUD")
+	float Stamina;
+	UPROPERTY(BlueprintReadOnly, Category = "HUD")
+	float MaxStamina;
+	UPROPERTY(BlueprintReadOnly, Category = "HUD")
+	int32 Coins;
+
+	/** Health and Stamina between 0 and 1 for the progress bars */
+	UFUNCTION(BlueprintPure, Category = "HUD")
+	float GetHealthPercent() const { return MaxHealth > 0.f ? Health / MaxHealth : 0.f; }
+	UFUNCTION(BlueprintPure, Category = "HUD")
+	float GetStaminaPercent() const { return MaxStamina > 0.f ? Stamina / MaxStamina : 0.f; }
+
+	/** Called once for every stat that changed */
+	UPROPERTY(BlueprintAssignable, Category = "HUD")
+	FOnHUDStatChanged OnStatChanged;
+
+private:
+	/** Bound to the attribute changes of the character */
+	void AttributeChanged(ECharacterAttribute Attribute, float Value);
+
+	TWeakObjectPtr<AMainCharacter> BoundCharacter;
+	FDelegateHandle AttributeChangedHandle;
+};
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InputBuffer.h"
+
+// One frame at 60 fps is 16.7 ms, the buckets double from one millisecond to half a second
+const double FInputBuffer::BucketLimitsMs[FInputBuffer::NumBucketLimits] = { 1.0, 2.0, 4.0, 8.0, 16.7, 33.3, 66.7, 133.3, 266.7, 533.3 };
+
+
+FInputBuffer::FInputBuffer()
+{
+	ResetLatency();
+}
+
+// Called by AMainCharacter when an attack key/button is pressed
+void FInputBuffer::Record(EBufferedAction Action)
+{
+	if (Presses.Num() >= MaxPresses)
+	{
+		Presses.RemoveAt(0, 1, false);
+		++NumExpired;
+	}
+	Presses.Add({ Action, FPlatformTime::Seconds() });
+	++NumPresses;
+}
+
+// Called by AMainCharacter::Attack() when an attack can start
+bool FInputBuffer::Consume(float Window, EBufferedAction& OutAction, double& OutPressTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	while (Presses.Num() > 0)
+	{
+		const FPress Press = Presses[0];
+		Presses.RemoveAt(0, 1, false);
+		if (Now - Press.Time <= Window)
+		{
+			OutAction = Press.Action;
+			OutPressTime = Press.Time;
+			return true;
+		}
+		++NumExpired;
+	}
+	return false;
+}
+
+// Called every frame by AMainCharacter while it isn't attacking
+bool FInputBuffer::HasPending(float Window) const
+{
+	// The newest press is the last one to expire
+	return Presses.Num() > 0 && FPlatformTime::Seconds() - Presses.Last().Time <= Window;
+}
+
+void FInputBuffer::Reset()
+{
+	Presses.Reset();
+}
+
+// Called when a press started an attack montage
+void FInputBuffer::RecordLatency(double Seconds)
+{
+	const double Ms = Seconds * 1000.0;
+	int32 Bucket = 0;
+	while (Bucket < NumBucketLimits && Ms > BucketLimitsMs[Bucket])
+	{
+		++Bucket;
+	}
+	++BucketCounts[Bucket];
+
+	++NumSamples;
+	TotalMs += Ms;
+	MinMs = FMath::Min(MinMs, Ms);
+	MaxMs = FMath::Max(MaxMs, Ms);
+}
+
+void FInputBuffer::ResetLatency()
+{
+	FMemory::Memzero(BucketCounts);
+	NumSamples = 0;
+	TotalMs = 0.0;
+	MinMs = DBL_MAX;
+	MaxMs = 0.0;
+	NumPresses = 0;
+	NumExpired = 0;
+}
+
+// Called with the console command "fp.DumpInputLatency"
+void FInputBuffer::DumpLatency(TArray<FString>& OutLines) const
+{
+	OutLines.Add(FString::Printf(TEXT("Input to montage start: %u samples, %u presses, %u expired"), NumSamples, NumPresses, NumExpired));
+	if (NumSamples == 0) return;
+
+	OutLines.Add(FString::Printf(TEXT("  min %.2f ms, mean %.2f ms, max %.2f ms"), MinMs, TotalMs / NumSamples, MaxMs));
+	for (int32 Bucket = 0; Bucket <= NumBucketLimits; ++Bucket)
+	{
+		if (BucketCounts[Bucket] == 0) continue;
+
+		const double Percent = 100.0 * BucketCounts[Bucket] / NumSamples;
+		const FString Range = Bucket < NumBucketLimits
+			? FString::Printf(TEXT("<= %6.1f ms"), BucketLimitsMs[Bucket])
+			: FString::Printf(TEXT(" > %6.1f ms"), BucketLimitsMs[NumBucketLimits - 1]);
+		OutLines.Add(FString::Printf(TEXT("  %s: %5u (%5.1f%%) %s"), *Range, BucketCounts[Bucket], Percent, *FString::ChrN(FMath::CeilToInt(Percent / 2.0), TEXT('#'))));
+	}
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Input buffer of the main character: every attack press is recorded with a high resolution timestamp, and a
+ * press that can't start an attack right away (attack playing, in the air) is replayed as soon as an attack
+ * can start, as long as it is younger than the buffer window. It also keeps a histogram of the time between
+ * a press and the start of the montage it triggered, printed with the console command "fp.DumpInputLatency".
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Actions the input buffer can hold */
+enum class EBufferedAction : uint8
+{
+	None,
+	LightAttack,
+	HeavyAttack
+};
+
+class FIRSTPROJECT_API FInputBuffer
+{
+public:
+	FInputBuffer();
+
+	/** Records a press of the action, timestamped with FPlatformTime::Seconds() */
+	void Record(EBufferedAction Action);
+
+	/** Takes the oldest press younger than Window seconds, the older ones are dropped
+	/* @return false when there is no press to replay */
+	bool Consume(float Window, EBufferedAction& OutAction, double& OutPressTime);
+
+	/** Is there a press younger than Window seconds */
+	bool HasPending(float Window) const;
+
+	/** Drops the presses (death, level change) */
+	void Reset();
+
+	/** Adds a sample to the latency histogram, time between the press and the montage start */
+	void RecordLatency(double Seconds);
+
+	/** Clears the latency histogram and the press counters */
+	void ResetLatency();
+
+	/** Appends the latency histogram, one line per bucket, to OutLines */
+	void DumpLatency(TArray<FString>& OutLines) const;
+
+private:
+	struct FPress
+	{
+		EBufferedAction Action;
+		double Time;
+	};
+
+	/** Presses waiting to be replayed, oldest first */
+	TArray<FPress, TInlineAllocator<4>> Presses;
+
+	/** Presses kept at most, the oldest is dropped past it */
+	static constexpr int32 MaxPresses = 4;
+
+	/** Upper limits of the histogram buckets in milliseconds, the last bucket has every sample above them */
+	static constexpr int32 NumBucketLimits = 10;
+	static const double BucketLimitsMs[NumBucketLimits];
+
+	uint32 BucketCounts[NumBucketLimits + 1];
+	uint32 NumSamples;
+	double TotalMs;
+	double MinMs;
+	double MaxMs;
+
+	/** Presses recorded, and presses dropped because they got older than the window */
+	uint32 NumPresses;
+	uint32 NumExpired;
+};
@@ -18,6 +18,55 @@
 #include "MainPlayerController.h"
 #include "FirstSaveGame.h"
 #include "WeaponContainerActor.h"
+#include "EnemyManagerSubsystem.h"
+#include "CombatAudioSubsystem.h"
+#include "GameplayTimerSubsystem.h"
+#include "SaveGameSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/Engine.h"
+
+#if !UE_BUILD_SHIPPING
+/** Prints the histogram of the time between an attack press of the player and the start of its montage */
+static void DumpInputLatency(UWorld* World)
+{
+	AMainCharacter* MainCharacter = Cast<AMainCharacter>(UGameplayStatics::GetPlayerCharacter(World, 0));
+	if (MainCharacter == nullptr) return;
+
+	TArray<FString> Lines;
+	MainCharacter->InputBuffer.DumpLatency(Lines);
+	for (const FString& Line : Lines)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s"), *Line);
+	}
+	if (GEngine)
+	{
+		// On screen messages are stacked newest first
+		for (int32 i = Lines.Num() - 1; i >= 0; --i)
+		{
+			GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Cyan, Lines[i]);
+		}
+	}
+}
+
+/** Clears the input latency histogram of the player */
+static void ResetInputLatency(UWorld* World)
+{
+	if (AMainCharacter* MainCharacter = Cast<AMainCharacter>(UGameplayStatics::GetPlayerCharacter(World, 0)))
+	{
+		MainCharacter->InputBuffer.ResetLatency();
+	}
+}
+
+static FAutoConsoleCommandWithWorld DumpInputLatencyCommand(
+	TEXT("fp.DumpInputLatency"),
+	TEXT("Prints the histogram of the time between an attack press and the start of its montage"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&DumpInputLatency));
+
+static FAutoConsoleCommandWithWorld ResetInputLatencyCommand(
+	TEXT("fp.ResetInputLatency"),
+	TEXT("Clears the input latency histogram"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&ResetInputLatency));
+#endif
 
 
 // Sets default values
@@ -70,9 +119,18 @@ AMainCharacter::AMainCharacter()
 	bSprintKeyDown = false;
 	StaminaDrainRate = 50.f;
 	LowStamina = 50.f;
+	StaminaSegmentValue = Stamina;
+	StaminaSegmentTime = 0.f;
+	StaminaRate = 0.f;
+	StaminaThreshold = 0.f;
+	StaminaEventTime = 0.f;
+	StaminaWritten = Stamina;
+	bStaminaSprintKeyDown = false;
+	bStaminaMoving = false;
 
 	bLightAttackKeyDown = false;
 	bHeavyAttackKeyDown = false;
+	InputBufferWindow = 0.3f;
 	bAttacking = false;
 
 	InterpSpeed = 7.f;
@@ -93,6 +151,22 @@ void AMainCharacter::BeginPlay()
 	
 	MainPlayerController = Cast<AMainPlayerController>(GetController()); // Getting Main player controller
 
+	// Starting stats from the values set in the editor, the first flush sends all of them
+	Attributes.OnAttributeChanged.AddUObject(this, &AMainCharacter::AttributeChanged);
+	Attributes.Set(ECharacterAttribute::ECA_Health, Health);
+	Attributes.Set(ECharacterAttribute::ECA_MaxHealth, MaxHealth);
+	Attributes.Set(ECharacterAttribute::ECA_Stamina, Stamina);
+	Attributes.Set(ECharacterAttribute::ECA_MaxStamina, MaxStamina);
+	Attributes.Set(ECharacterAttribute::ECA_Coins, (float)Coins);
+	Attributes.Set(ECharacterAttribute::ECA_MoveSpeed, RunningSpeed);
+	Attributes.MarkAllDirty();
+	StaminaSegmentValue = StaminaWritten = Stamina;
+	StatsSnapshot.Health = Health;
+	StatsSnapshot.MaxHealth = MaxHealth;
+	StatsSnapshot.Stamina = Stamina;
+	StatsSnapshot.MaxStamina = MaxStamina;
+	StatsSnapshot.Coins = Coins;
+
 	// Get level name without prefix
 	FString Map = GetWorld()->GetMapName();
 	Map.RemoveFromStart(GetWorld()->StreamingLevelsPrefix);
@@ -108,6 +182,9 @@ void AMainCharacter::BeginPlay()
 			MainPlayerController->GameModeOnly();
 		}
 	}
+
+	UpdateStamina(); // First stamina segment and running speed
+	FlushAttributes();
 }
 
 // Called every frame
@@ -116,104 +193,42 @@ void AMainCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	if (MovementStatus == EMovementStatus::EMS_Dead) return;
-	
-	// Functionality for Stamina Bar
-	float DeltaStamina = StaminaDrainRate * DeltaTime;
-	switch (StaminaStatus)
+	if (MovementStatus == EMovementStatus::EMS_Dead)
 	{
-	case EStaminaStatus::ESS_Normal: // Stamina bar is above LowStamina threshold
-		if (bSprintKeyDown) // Sprint key pressed
-		{
-			if (bMovingForward || bMovingRight)
-			{
-				SetMovementStatus(EMovementStatus::EMS_Sprinting);
-				Stamina -= DeltaStamina;
-			}
-			else
-			{
-				SetMovementStatus(EMovementStatus::EMS_Normal);
-			}
-			
-			if (Stamina <= LowStamina)
-			{
-				SetStaminaStatus(EStaminaStatus::ESS_LowStamina);
-			}
+		FlushAttributes(); // The killing hit still reaches the HUD
+		return;
+	}
 
-		}
-		else // Sprint key released
-		{
-			SetMovementStatus(EMovementStatus::EMS_Normal);
-			
-			if (Stamina < MaxStamina)
-			{
-				Stamina += DeltaStamina;
-			}
-			
-		}
-		break;
+	// Both movement axes ran before the tick, the moving input is checked once with the two of them
+	UpdateMovingInput();
 
-	case EStaminaStatus::ESS_LowStamina: // Stamina Bar is below Low Stamina threshold
-		if (bSprintKeyDown) // Sprint key pressed
-		{
-			if (bMovingForward || bMovingRight)
-			{
-				SetMovementStatus(EMovementStatus::EMS_Sprinting);
-				Stamina -= DeltaStamina;
-			}
-			else
-			{
-				SetMovementStatus(EMovementStatus::EMS_Normal);
-			}
-
-			if (Stamina <= 0.f)
-			{
-				SetMovementStatus(EMovementStatus::EMS_Normal);
-				SetStaminaStatus(EStaminaStatus::ESS_Exhausted);
-			}
+	// Attack pressed in the air, replayed once landed if the press is still in the buffer window
+	if (!bAttacking && EquippedWeapon && InputBuffer.HasPending(InputBufferWindow))
+	{
+		Attack();
+	}
+	
+	// Functionality for Stamina Bar, only the current segment is evaluated here, the status changes happen in UpdateStamina()
+	if (Attributes.Get(ECharacterAttribute::ECA_Stamina) != StaminaWritten)
+	{
+		UpdateStamina(); // Stamina loaded or set by a blueprint, the segment starts again from it
+	}
+	else if (StaminaRate != 0.f)
+	{
+		StaminaWritten = GetStaminaAt(GetWorld()->GetTimeSeconds());
+		Attributes.Set(ECharacterAttribute::ECA_Stamina, StaminaWritten);
+	}
 
-		}
-		else // Sprint key released
+	// Between attacks the combat target follows the nearest enemy, the index of the enemy manager keeps it at hand
+	if (bHasCombatTarget && !bInterpToEnemy)
+	{
+		if (UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this))
 		{
-			SetMovementStatus(EMovementStatus::EMS_Normal);
-			
-			if (Stamina < LowStamina)
-			{
-				Stamina += DeltaStamina;
-			}
-			else
+			if (AEnemy* NearestEnemy = EnemyManager->GetNearestEnemyInCombatRange(EnemyFilter))
 			{
-				SetStaminaStatus(EStaminaStatus::ESS_Normal);
-				Stamina += DeltaStamina;
+				SetCombatTarget(NearestEnemy);
 			}
-
-		}
-		break;
-
-	case EStaminaStatus::ESS_Exhausted: // Stamina reached 0
-		SetMovementStatus(EMovementStatus::EMS_Normal);
-		if (bSprintKeyDown) // Sprint key pressed
-		{
-			Stamina = 0.f;
 		}
-		else // Sprint key released
-		{
-			SetStaminaStatus(EStaminaStatus::ESS_ExhastedRecovering);
-			Stamina += DeltaStamina;
-		}
-		break;
-
-	case EStaminaStatus::ESS_ExhastedRecovering: // Stamina Recovery from 0 until Low Stamina threshold
-		SetMovementStatus(EMovementStatus::EMS_Normal);
-		Stamina += DeltaStamina;
-		if (Stamina >= LowStamina)
-		{
-			SetStaminaStatus(EStaminaStatus::ESS_Normal);
-		}
-		break;
-
-	default:
-		;
 	}
 
 	// Functionality to Interpolate towards enemy when inside its combat sphere collision
@@ -233,6 +248,8 @@ void AMainCharacter::Tick(float DeltaTime)
 			MainPlayerController->EnemyLocation = CombatTargetLocation; // Updating the enemy location in the controller
 		}
 	}
+
+	FlushAttributes();
 }
 
 // Called to bind functionality to input
@@ -364,13 +381,187 @@ void AMainCharacter::LookUp(float Value)
 void AMainCharacter::SetMovementStatus(EMovementStatus Status)
 {
 	MovementStatus = Status;
-	if (MovementStatus == EMovementStatus::EMS_Sprinting)
+	// MaxWalkSpeed is only written by AttributeChanged() when the speed changes
+	Attributes.Set(ECharacterAttribute::ECA_MoveSpeed, MovementStatus == EMovementStatus::EMS_Sprinting ? SprintingSpeed : RunningSpeed);
+}
+
+// Called when the sprint or movement input changes, when a stamina threshold is reached and on death
+void AMainCharacter::UpdateStamina()
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	UGameplayTimerSubsystem* GameplayTimers = UGameplayTimerSubsystem::Get(this);
+
+	if (Attributes.Get(ECharacterAttribute::ECA_Stamina) != StaminaWritten)
 	{
-		GetCharacterMovement()->MaxWalkSpeed = SprintingSpeed;
+		// Stamina loaded or set by a blueprint, the segment starts again from it
+		StaminaSegmentValue = Attributes.Get(ECharacterAttribute::ECA_Stamina);
+		StaminaSegmentTime = Now;
+		StaminaRate = 0.f;
 	}
 	else
 	{
-		GetCharacterMovement()->MaxWalkSpeed = RunningSpeed;
+		// Thresholds reached since the segment started, each one at its exact time with the input of that time,
+		// so the stamina doesn't depend on the frame rate or on when the timer fired
+		while (StaminaRate != 0.f && StaminaEventTime <= Now)
+		{
+			StartStaminaSegment(StaminaEventTime, StaminaThreshold);
+		}
+	}
+	const float Value = GetStaminaAt(Now);
+
+	if (MovementStatus == EMovementStatus::EMS_Dead)
+	{
+		// The stamina stops where it is
+		StaminaWritten = StaminaSegmentValue = Value;
+		Attributes.Set(ECharacterAttribute::ECA_Stamina, Value);
+		StaminaRate = 0.f;
+		if (GameplayTimers) GameplayTimers->ClearTimer(StaminaTimer);
+		return;
+	}
+
+	bStaminaSprintKeyDown = bSprintKeyDown;
+	bStaminaMoving = bMovingForward || bMovingRight;
+	StartStaminaSegment(Now, Value);
+	StaminaWritten = StaminaSegmentValue;
+	Attributes.Set(ECharacterAttribute::ECA_Stamina, StaminaWritten);
+
+	if (GameplayTimers)
+	{
+		if (StaminaRate != 0.f)
+		{
+			GameplayTimers->SetTimer(StaminaTimer, this, &AMainCharacter::UpdateStamina, FMath::Max(StaminaEventTime - Now, KINDA_SMALL_NUMBER));
+		}
+		else
+		{
+			GameplayTimers->ClearTimer(StaminaTimer);
+		}
+	}
+}
+
+// Called by UpdateStamina() for the current input and for every threshold reached
+void AMainCharacter::StartStaminaSegment(float Time, float Value)
+{
+	const bool bSprinting = bStaminaSprintKeyDown && bStaminaMoving;
+
+	// Stamina status changes, same rules as the former per frame state machine
+	EStaminaStatus PreviousStatus;
+	do
+	{
+		PreviousStatus = StaminaStatus;
+		switch (StaminaStatus)
+		{
+		case EStaminaStatus::ESS_Normal: // Stamina bar is above LowStamina threshold
+			if (bStaminaSprintKeyDown && Value <= LowStamina)
+			{
+				SetStaminaStatus(EStaminaStatus::ESS_LowStamina);
+			}
+			break;
+
+		case EStaminaStatus::ESS_LowStamina: // Stamina Bar is below Low Stamina threshold
+			if (bSprinting && Value <= 0.f)
+			{
+				Value = 0.f;
+				SetStaminaStatus(EStaminaStatus::ESS_Exhausted);
+			}
+			else if (!bStaminaSprintKeyDown && Value >= LowStamina)
+			{
+				SetStaminaStatus(EStaminaStatus::ESS_Normal);
+			}
+			break;
+
+		case EStaminaStatus::ESS_Exhausted: // Stamina reached 0
+			if (bStaminaSprintKeyDown)
+			{
+				Value = 0.f;
+			}
+			else
+			{
+				SetStaminaStatus(EStaminaStatus::ESS_ExhastedRecovering);
+			}
+			break;
+
+		case EStaminaStatus::ESS_ExhastedRecovering: // Stamina Recovery from 0 until Low Stamina threshold
+			if (Value >= LowStamina)
+			{
+				SetStaminaStatus(EStaminaStatus::ESS_Normal);
+			}
+			break;
+
+		default:
+			;
+		}
+	} while (StaminaStatus != PreviousStatus);
+
+	// Rate until the next threshold, draining while sprinting and recovering with the sprint key/button released
+	float Rate = 0.f;
+	float Threshold = Value;
+	bool bSprintSpeed = false;
+	switch (StaminaStatus)
+	{
+	case EStaminaStatus::ESS_Normal:
+		if (bStaminaSprintKeyDown)
+		{
+			bSprintSpeed = bSprinting;
+			Rate = bSprinting ? -StaminaDrainRate : 0.f;
+			Threshold = LowStamina;
+		}
+		else if (Value < Attributes.Get(ECharacterAttribute::ECA_MaxStamina))
+		{
+			Rate = StaminaDrainRate;
+			Threshold = Attributes.Get(ECharacterAttribute::ECA_MaxStamina);
+		}
+		break;
+
+	case EStaminaStatus::ESS_LowStamina:
+		if (bStaminaSprintKeyDown)
+		{
+			bSprintSpeed = bSprinting;
+			Rate = bSprinting ? -StaminaDrainRate : 0.f;
+			Threshold = 0.f;
+		}
+		else
+		{
+			Rate = StaminaDrainRate;
+			Threshold = LowStamina;
+		}
+		break;
+
+	case EStaminaStatus::ESS_ExhastedRecovering:
+		Rate = StaminaDrainRate;
+		Threshold = LowStamina;
+		break;
+
+	default: // Exhausted with the sprint key/button held, the stamina stays at 0
+		;
+	}
+	if (MovementStatus != EMovementStatus::EMS_Dead)
+	{
+		SetMovementStatus(bSprintSpeed ? EMovementStatus::EMS_Sprinting : EMovementStatus::EMS_Normal);
+	}
+
+	StaminaSegmentValue = Value;
+	StaminaSegmentTime = Time;
+	StaminaRate = Rate;
+	StaminaThreshold = Threshold;
+	StaminaEventTime = Rate != 0.f ? Time + (Threshold - Value) / Rate : Time;
+}
+
+// Called every frame while the stamina changes, the value is clamped to the threshold until UpdateStamina() runs
+float AMainCharacter::GetStaminaAt(float Time) const
+{
+	if (StaminaRate == 0.f) return StaminaSegmentValue;
+
+	const float Value = StaminaSegmentValue + StaminaRate * (Time - StaminaSegmentTime);
+	return StaminaRate > 0.f ? FMath::Min(Value, StaminaThreshold) : FMath::Max(Value, StaminaThreshold);
+}
+
+// Called at the start of Tick(), once the input of both movement axes was processed for the frame
+void AMainCharacter::UpdateMovingInput()
+{
+	const bool bMoving = bMovingForward || bMovingRight;
+	if (bMoving != bStaminaMoving && bSprintKeyDown) // Only matters for the stamina while sprinting
+	{
+		UpdateStamina();
 	}
 }
 
@@ -378,40 +569,97 @@ void AMainCharacter::SetMovementStatus(EMovementStatus Status)
 void AMainCharacter::SprintKeyPressed()
 {
 	bSprintKeyDown = true;
+	UpdateStamina();
 }
 
 // Called when player releases the spinting key/button
 void AMainCharacter::SprintKeyReleased()
 {
 	bSprintKeyDown = false;
+	UpdateStamina();
 }
 
 // Called when player gets a new coin
 void AMainCharacter::IncrementCoins(int32 Amount)
 {
-	Coins += Amount;
+	Attributes.Set(ECharacterAttribute::ECA_Coins, Attributes.Get(ECharacterAttribute::ECA_Coins) + (float)Amount);
 }
 
 // Called when player interacts with a health increasing item
 void AMainCharacter::IncrementHealth(float Amount)
 {
-	Health += Amount;
-	if (Health > MaxHealth)
-	{
-		Health = MaxHealth;
-	}
+	const float MaxHealthValue = Attributes.Get(ECharacterAttribute::ECA_MaxHealth);
+	Attributes.Set(ECharacterAttribute::ECA_Health, FMath::Min(Attributes.Get(ECharacterAttribute::ECA_Health) + Amount, MaxHealthValue));
 }
 
 // Called when player takes damage
 void AMainCharacter::DecrementHealth(float Amount)
 {
-	Health -= Amount;
-	if (Health <= 0.f)
+	Attributes.Set(ECharacterAttribute::ECA_Health, Attributes.Get(ECharacterAttribute::ECA_Health) - Amount);
+	if (Attributes.Get(ECharacterAttribute::ECA_Health) <= 0.f)
 	{
 		PlayerDead();
 	}
 }
 
+// Called at the end of Tick(), after the loads and before saving
+void AMainCharacter::FlushAttributes()
+{
+	PullBlueprintStatWrites();
+	Attributes.Flush();
+}
+
+// Called by FlushAttributes(), a copy that differs from the value last written to it was set by a blueprint
+void AMainCharacter::PullBlueprintStatWrites()
+{
+	if (Health != StatsSnapshot.Health)
+	{
+		Attributes.Set(ECharacterAttribute::ECA_Health, Health);
+	}
+	if (Stamina != StatsSnapshot.Stamina)
+	{
+		Attributes.Set(ECharacterAttribute::ECA_Stamina, Stamina); // Tick() starts a new stamina segment from it
+	}
+	if (Coins != StatsSnapshot.Coins)
+	{
+		Attributes.Set(ECharacterAttribute::ECA_Coins, (float)Coins);
+	}
+}
+
+// Called by Attributes.Flush() once for every attribute that changed since the last flush
+void AMainCharacter::AttributeChanged(ECharacterAttribute Attribute, float Value)
+{
+	switch (Attribute)
+	{
+	case ECharacterAttribute::ECA_Health:
+		Health = StatsSnapshot.Health = Value;
+		break;
+
+	case ECharacterAttribute::ECA_MaxHealth:
+		MaxHealth = StatsSnapshot.MaxHealth = Value;
+		break;
+
+	case ECharacterAttribute::ECA_Stamina:
+		Stamina = StatsSnapshot.Stamina = Value;
+		break;
+
+	case ECharacterAttribute::ECA_MaxStamina:
+		MaxStamina = StatsSnapshot.MaxStamina = Value;
+		break;
+
+	case ECharacterAttribute::ECA_Coins:
+		Coins = StatsSnapshot.Coins = FMath::RoundToInt(Value);
+		break;
+
+	case ECharacterAttribute::ECA_MoveSpeed:
+		GetCharacterMovement()->MaxWalkSpeed = Value;
+		break;
+
+	default:
+		;
+	}
+}
+
 // Called when player hits the Interact key/button
 void AMainCharacter::InteractKeyPressed()
 {
@@ -452,6 +700,7 @@ void AMainCharacter::LightAttackKeyPressed()
 
 	if (EquippedWeapon)
 	{
+		InputBuffer.Record(EBufferedAction::LightAttack); // Replayed later if the attack can't start now
 		Attack();
 	}
 }
@@ -473,6 +722,7 @@ void AMainCharacter::HeavyAttackKeyPressed()
 
 	if (EquippedWeapon)
 	{
+		InputBuffer.Record(EBufferedAction::HeavyAttack); // Replayed later if the attack can't start now
 		Attack();
 	}
 }
@@ -489,21 +739,38 @@ void AMainCharacter::Attack()
 	bool bInTheAir = GetMovementComponent()->IsFalling(); // Checking if character is in the air
 	if (!bAttacking && MovementStatus != EMovementStatus::EMS_Dead && !bInTheAir)
 	{
+		// A buffered press first, then the key/button held to chain the attacks
+		EBufferedAction Action = EBufferedAction::None;
+		double PressTime = 0.0;
+		if (!InputBuffer.Consume(InputBufferWindow, Action, PressTime))
+		{
+			if (bLightAttackKeyDown) Action = EBufferedAction::LightAttack;
+			else if (bHeavyAttackKeyDown) Action = EBufferedAction::HeavyAttack;
+		}
+		if (Action == EBufferedAction::None) return;
+
 		bAttacking = true;
 		SetInterpToEnemy(true); // Interpolate towards enemy when attacking
 		UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance(); // Getting the main character anim instance to use Montage_Play()
 		if (AnimInstance && CombatMontage)
 		{
-			if (bLightAttackKeyDown)
+			float MontageLength = 0.f;
+			if (Action == EBufferedAction::LightAttack)
 			{
-				AnimInstance->Montage_Play(CombatMontage, 0.9f);
+				MontageLength = AnimInstance->Montage_Play(CombatMontage, 0.9f);
 				AnimInstance->Montage_JumpToSection(FName("Attack_1"), CombatMontage);
 			}
-			else if (bHeavyAttackKeyDown)
+			else
 			{
-				AnimInstance->Montage_Play(CombatMontage, 1.f);
+				MontageLength = AnimInstance->Montage_Play(CombatMontage, 1.f);
 				AnimInstance->Montage_JumpToSection(FName("Attack_2"), CombatMontage);
 			}
+
+			// Only presses are measured, not the attacks chained with the key/button held
+			if (MontageLength > 0.f && PressTime > 0.0)
+			{
+				InputBuffer.RecordLatency(FPlatformTime::Seconds() - PressTime);
+			}
 		}
 	}
 }
@@ -513,9 +780,9 @@ void AMainCharacter::AttackEnd()
 {
 	bAttacking = false;
 	SetInterpToEnemy(false); // Stop interpolation after attacking
-	if (bLightAttackKeyDown || bHeavyAttackKeyDown)
+	if (bLightAttackKeyDown || bHeavyAttackKeyDown || InputBuffer.HasPending(InputBufferWindow))
 	{
-		Attack();
+		Attack(); // Presses that landed during the attack are replayed here
 	}
 }
 
@@ -524,7 +791,7 @@ void AMainCharacter::PlaySwingSound()
 {
 	if (EquippedWeapon->SwingSound)
 	{
-		UGameplayStatics::PlaySound2D(this, EquippedWeapon->SwingSound);
+		UCombatAudioSubsystem::PlayCue(this, EquippedWeapon->SwingSound, GetActorLocation(), 2.f);
 	}
 }
 
@@ -534,7 +801,7 @@ void AMainCharacter::SetInterpToEnemy(bool Interp)
 	bInterpToEnemy = Interp;
 }
 
-// Called when character enters the enemy CombatSphere
+// Called when character enters the enemy combat range
 FRotator AMainCharacter::GetLookAtRotationYaw(FVector Target)
 {
 	FRotator LookAtRotation = UKismetMathLibrary::FindLookAtRotation(GetActorLocation(), Target); // Rotation from the character location to the target
@@ -545,10 +812,11 @@ FRotator AMainCharacter::GetLookAtRotationYaw(FVector Target)
 // Called when player enters and exits combat with enemies
 void AMainCharacter::UpdateCombatTarget()
 {
-	TArray<AActor*> OverlappingActors; // TArray to save all the actors (enemies) currently overlapping with the player
-	GetOverlappingActors(OverlappingActors, EnemyFilter); // Get all the enemies overlapping
+	// Nearest enemy in combat with the player, read from the nearest enemy index of the enemy manager
+	UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this);
+	AEnemy* ClosestEnemy = EnemyManager ? EnemyManager->GetNearestEnemyInCombatRange(EnemyFilter) : nullptr;
 
-	if (OverlappingActors.Num() == 0)
+	if (ClosestEnemy == nullptr)
 	{
 		if (MainPlayerController)
 		{
@@ -557,44 +825,21 @@ void AMainCharacter::UpdateCombatTarget()
 		return;
 	}
 
-	AEnemy* ClosestEnemy = Cast<AEnemy>(OverlappingActors[0]); // Getting the first enemy in the array
-	if (ClosestEnemy)
+	// Display HealthBar of the closest enemy to the player
+	if (MainPlayerController)
 	{
-		FVector Location = GetActorLocation(); // Main Character location
-		float MinDistance = (ClosestEnemy->GetActorLocation() - Location).Size(); // Distance between enemy and Main character
-
-		for (auto Actor : OverlappingActors) // Loop thru OverlappingActors array
-		{
-			AEnemy* Enemy = Cast<AEnemy>(Actor); //Getting the enemy at the index of the current iteration of the loop
-			if (Enemy)
-			{
-				float DistanceToActor = (Enemy->GetActorLocation() - Location).Size(); // Distance between current enemy in the loop and Main character
-				if (DistanceToActor < MinDistance)
-				{
-					// If any of the enemies from Index 1 or greater are closer than enemy at index 0
-					// change the ClosestEnemy and the MinDistance variables to the new closest enemy and its location
-					MinDistance = DistanceToActor;
-					ClosestEnemy = Enemy;
-				}
-			}
-		}
-
-		// Display HealthBar of the closest enemy to the player
-		if (MainPlayerController)
-		{
-			MainPlayerController->DisplayEnemyHealthBar();
-		}
-		// Set CombatTarget to the closest enemy to make Interpolation functionality work
-		SetCombatTarget(ClosestEnemy);
-		bHasCombatTarget = true;
+		MainPlayerController->DisplayEnemyHealthBar();
 	}
+	// Set CombatTarget to the closest enemy to make Interpolation functionality work
+	SetCombatTarget(ClosestEnemy);
+	bHasCombatTarget = true;
 }
 
-// Called by ApplyDamage() in the HitboxOnOverlapBegin function of AEnemy
+// Called by UDamageQueueSubsystem::ResolveHits() for the hits of the enemies and the hazards
 float AMainCharacter::TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser)
 {
-	Health -= DamageAmount;
-	if (Health <= 0.f)
+	Attributes.Set(ECharacterAttribute::ECA_Health, Attributes.Get(ECharacterAttribute::ECA_Health) - DamageAmount);
+	if (Attributes.Get(ECharacterAttribute::ECA_Health) <= 0.f)
 	{
 		PlayerDead();
 
@@ -603,7 +848,7 @@ float AMainCharacter::TakeDamage(float DamageAmount, struct FDamageEvent const&
 			AEnemy* Enemy = Cast<AEnemy>(DamageCauser);
 			if (Enemy)
 			{
-				Enemy->bHasValidTarget = false; // Stop enemy from attacking after main character dies
+				Enemy->SetHasValidTarget(false); // Stop enemy from attacking after main character dies
 			}
 		}
 	}
@@ -624,6 +869,8 @@ void AMainCharacter::PlayerDead()
 		AnimInstance->Montage_JumpToSection(FName("Death"));
 	}
 	SetMovementStatus(EMovementStatus::EMS_Dead);
+	InputBuffer.Reset();
+	UpdateStamina(); // The stamina stops changing
 }
 
 // Called after player dies
@@ -675,12 +922,9 @@ void AMainCharacter::SaveGame()
 	//   the USaveGame object is casted to a UFirstSaveGame object and stored in SaveObject.
 	UFirstSaveGame* SaveObject = Cast<UFirstSaveGame>(UGameplayStatics::CreateSaveGameObject(UFirstSaveGame::StaticClass()));
 	
-	// Copying variables to SaveObject
-	SaveObject->CharacterStats.Health = Health;
-	SaveObject->CharacterStats.MaxHealth = MaxHealth;
-	SaveObject->CharacterStats.Stamina = Stamina;
-	SaveObject->CharacterStats.MaxStamina = MaxStamina;
-	SaveObject->CharacterStats.Coins = Coins;
+	// Copying variables to SaveObject, the stats come from the snapshot kept by the attribute changes
+	FlushAttributes();
+	SaveObject->CharacterStats = StatsSnapshot;
 	SaveObject->CharacterStats.Location = GetActorLocation();
 	SaveObject->CharacterStats.Rotation = GetActorRotation();
 
@@ -697,8 +941,9 @@ void AMainCharacter::SaveGame()
 		SaveObject->CharacterStats.bWeaponParticles = EquippedWeapon->bWeaponParticles;
 	}
 
-	// Saving everyithing that was copied in SaveObject to the selected save slot in the menu
-	UGameplayStatics::SaveGameToSlot(SaveObject, SaveObject->SaveSlotName, SaveObject->UserIndex);
+	// Saving everyithing that was copied in SaveObject to the selected save slot in the menu,
+	// the serialization and the file write happen in the background
+	USaveGameSubsystem::SaveGameToSlot(this, SaveObject, SaveObject->SaveSlotName, SaveObject->UserIndex);
 }
 
 // Called when selecting Load Game from the pause menu
@@ -706,6 +951,11 @@ void AMainCharacter::LoadGame(bool LoadPosition)
 {
 	// Creating a USaveGame object to get the SlotName and SlotNumber (index) from the menu
 	UFirstSaveGame* Load = Cast<UFirstSaveGame>(UGameplayStatics::CreateSaveGameObject(UFirstSaveGame::StaticClass()));
+	// Waiting for the saves still being written, the slot must have the last saved data
+	if (USaveGameSubsystem* SaveGameSubsystem = USaveGameSubsystem::Get(this))
+	{
+		SaveGameSubsystem->FlushSaves();
+	}
 	// Creating another USaveGame object to load all the stored data from the selected save file
 	UFirstSaveGame* LoadObject = Cast<UFirstSaveGame>(UGameplayStatics::LoadGameFromSlot(Load->SaveSlotName, Load->UserIndex));
 
@@ -719,11 +969,11 @@ void AMainCharacter::LoadGame(bool LoadPosition)
 		}
 
 		// Loading the character stats
-		Health = LoadObject->CharacterStats.Health;
-		MaxHealth = LoadObject->CharacterStats.MaxHealth;
-		Stamina = LoadObject->CharacterStats.Stamina;
-		MaxStamina = LoadObject->CharacterStats.MaxStamina;
-		Coins = LoadObject->CharacterStats.Coins;
+		Attributes.Set(ECharacterAttribute::ECA_Health, LoadObject->CharacterStats.Health);
+		Attributes.Set(ECharacterAttribute::ECA_MaxHealth, LoadObject->CharacterStats.MaxHealth);
+		Attributes.Set(ECharacterAttribute::ECA_Stamina, LoadObject->CharacterStats.Stamina);
+		Attributes.Set(ECharacterAttribute::ECA_MaxStamina, LoadObject->CharacterStats.MaxStamina);
+		Attributes.Set(ECharacterAttribute::ECA_Coins, (float)LoadObject->CharacterStats.Coins);
 
 		// Loading the weapon
 		if (WeaponContainer)
@@ -760,6 +1010,8 @@ void AMainCharacter::LoadGame(bool LoadPosition)
 		SetMovementStatus(EMovementStatus::EMS_Normal);
 		GetMesh()->bPauseAnims = false;
 		GetMesh()->bNoSkeletonUpdate = false;
+		UpdateStamina(); // The stamina segment starts again from the loaded value
+		FlushAttributes();
 	}
 }
 
@@ -767,15 +1019,19 @@ void AMainCharacter::LoadGame(bool LoadPosition)
 void AMainCharacter::LoadGameNoSwitch()
 {
 	UFirstSaveGame* Load = Cast<UFirstSaveGame>(UGameplayStatics::CreateSaveGameObject(UFirstSaveGame::StaticClass()));
+	if (USaveGameSubsystem* SaveGameSubsystem = USaveGameSubsystem::Get(this))
+	{
+		SaveGameSubsystem->FlushSaves();
+	}
 	UFirstSaveGame* LoadObject = Cast<UFirstSaveGame>(UGameplayStatics::LoadGameFromSlot(Load->SaveSlotName, Load->UserIndex));
 
 	if (LoadObject)
 	{
-		Health = LoadObject->CharacterStats.Health;
-		MaxHealth = LoadObject->CharacterStats.MaxHealth;
-		Stamina = LoadObject->CharacterStats.Stamina;
-		MaxStamina = LoadObject->CharacterStats.MaxStamina;
-		Coins = LoadObject->CharacterStats.Coins;
+		Attributes.Set(ECharacterAttribute::ECA_Health, LoadObject->CharacterStats.Health);
+		Attributes.Set(ECharacterAttribute::ECA_MaxHealth, LoadObject->CharacterStats.MaxHealth);
+		Attributes.Set(ECharacterAttribute::ECA_Stamina, LoadObject->CharacterStats.Stamina);
+		Attributes.Set(ECharacterAttribute::ECA_MaxStamina, LoadObject->CharacterStats.MaxStamina);
+		Attributes.Set(ECharacterAttribute::ECA_Coins, (float)LoadObject->CharacterStats.Coins);
 
 
 		if (WeaponContainer)
@@ -804,6 +1060,8 @@ void AMainCharacter::LoadGameNoSwitch()
 		SetMovementStatus(EMovementStatus::EMS_Normal);
 		GetMesh()->bPauseAnims = false;
 		GetMesh()->bNoSkeletonUpdate = false;
+		UpdateStamina(); // The stamina segment starts again from the loaded value
+		FlushAttributes();
 	}
 }
 
@@ -10,6 +10,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "InputBuffer.h"
+#include "GameplayTimerWheel.h"
+#include "CharacterAttributes.h"
 #include "MainCharacter.generated.h"
 
 /** Struct to save data for future play */
@@ -101,7 +104,9 @@ public:
 
 	/// Player Character variables
 	//
-	/** Player Stats */
+	/** Player Stats, the values set in the editor are the starting values of Attributes,
+	/* then these are the copies read by the HUD, written when the attribute changes.
+	/* A blueprint write to Health, Stamina or Coins is passed to Attributes on the next flush */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Player Stats")
 	float Health;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Player Stats")
@@ -113,6 +118,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Player Stats")
 	int32 Coins;
 
+	/** Stats with change tracking, every change reaches the HUD copies, the movement speed and the save snapshot on the next flush */
+	FCharacterAttributes Attributes;
+
+	/** Stats as they are saved, kept up to date by the attribute changes */
+	FCharacterStats StatsSnapshot;
+
 	/** Player is moving Y/N */
 	bool bMovingForward;
 	bool bMovingRight;
@@ -140,6 +151,24 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Stamina)
 	float LowStamina;
 
+	/** Analytic stamina: from StaminaSegmentValue at StaminaSegmentTime (world time) the stamina changes at StaminaRate per second
+	/* until it reaches StaminaThreshold at StaminaEventTime. Only recomputed by UpdateStamina() when the input changes or a threshold is reached */
+	float StaminaSegmentValue;
+	float StaminaSegmentTime;
+	float StaminaRate;
+	float StaminaThreshold;
+	float StaminaEventTime;
+
+	/** Last value the model wrote to Stamina, any other value was written by a load or a blueprint */
+	float StaminaWritten;
+
+	/** Input the current stamina segment was computed with */
+	bool bStaminaSprintKeyDown;
+	bool bStaminaMoving;
+
+	/** Fires UpdateStamina() when the next threshold is reached */
+	FGameplayTimerHandle StaminaTimer;
+
 
 	/// Combat and Interactivity variables
 	//
@@ -161,6 +190,13 @@ public:
 	/** HeavyAttack key/button pressed Y/N */
 	bool bHeavyAttackKeyDown;
 
+	/** Timestamped attack presses, replayed when an attack can start */
+	FInputBuffer InputBuffer;
+
+	/** Seconds an attack press stays in the input buffer, a press older than this is dropped instead of replayed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat)
+	float InputBufferWindow;
+
 	/** Player is attacking Y/N */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Anims)
 	bool bAttacking;
@@ -197,8 +233,7 @@ public:
 	FVector CombatTargetLocation;
 
 	/** Variable to use in the UpdateCombatTarget() function. 
-	/* This variable will be used to make sure only enemies are included 
-	/* in the TArray OverlappingActors inside the function */
+	/* This variable will be used to make sure only enemies of this class can become the combat target */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat)
 	TSubclassOf<AEnemy> EnemyFilter;
 
@@ -271,6 +306,19 @@ public:
 	/** Set Stamina Status enum */
 	FORCEINLINE void SetStaminaStatus(EStaminaStatus Status) { StaminaStatus = Status; }
 
+	/** Applies the thresholds reached since the last call at their exact time, then starts a stamina segment with the current input
+	/* and schedules the next threshold. Called when the sprint or movement input changes, when a threshold is reached and on death */
+	void UpdateStamina();
+
+	/** Stamina status changes at the value, then rate, threshold and movement status of the segment starting at the world time */
+	void StartStaminaSegment(float Time, float Value);
+
+	/** Stamina of the current segment at the world time */
+	float GetStaminaAt(float Time) const;
+
+	/** Called by Tick() after both movement axes, updates the stamina when the character starts or stops moving */
+	void UpdateMovingInput();
+
 	/** Press key/button to sprint */
 	void SprintKeyPressed();
 
@@ -280,6 +328,21 @@ public:
 
 	/// Character Stat modification functions
 	//
+	/** Getter and setter for the Attributes, any stat can be read and changed from blueprints through these */
+	UFUNCTION(BlueprintPure)
+	float GetAttribute(ECharacterAttribute Attribute) const { return Attributes.Get(Attribute); }
+	UFUNCTION(BlueprintCallable)
+	void SetAttribute(ECharacterAttribute Attribute, float Value) { Attributes.Set(Attribute, Value); }
+
+	/** Sends the attributes that changed to their consumers, once per frame and before saving */
+	void FlushAttributes();
+
+	/** Passes the stat copies written by a blueprint since the last flush to Attributes */
+	void PullBlueprintStatWrites();
+
+	/** Bound to Attributes.OnAttributeChanged, copies the new value to the HUD, the movement component and the save snapshot */
+	void AttributeChanged(ECharacterAttribute Attribute, float Value);
+
 	/** Increases player coins count */
 	UFUNCTION(BlueprintCallable)
 	void IncrementCoins(int32 Amount);
@@ -319,7 +382,7 @@ public:
 	/** Release key/button to stop HeavyAttacking */
 	void HeavyAttackKeyReleased();
 
-	/** Enter combat animation and stop character movement */
+	/** Enter combat animation and stop character movement, with the buffered press or the key/button held */
 	void Attack();
 
 	/** Exit combat animation and return control to player */
@@ -2,11 +2,23 @@
 
 #include "MainPlayerController.h"
 #include "Blueprint/UserWidget.h"
+#include "MainCharacter.h"
+#include "HUDViewModel.h"
+#include "HUDOverlayWidget.h"
+#include "EnemyHealthBarLayer.h"
+#include "WidgetPoolSubsystem.h"
+#include "EnemyManagerSubsystem.h"
+#include "Enemy.h"
+#include "Engine/LocalPlayer.h"
+#include "SceneView.h"
 
 // Sets default values
 AMainPlayerController::AMainPlayerController()
 {
 	bPauseMenuOpen = false;
+	bEnemyHealthBarVisible = false;
+	WEnemyHealthBarLayer = UEnemyHealthBarLayer::StaticClass();
+	EnemyHealthBarLayer = nullptr;
 }
 
 // Called when the game starts or when spawned
@@ -14,40 +26,129 @@ void AMainPlayerController::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// If HUDOverlayAsset is selected in the Blueprint, create the widget and add it to viewport
+	// The character can be possessed before or after BeginPlay
+	HUDViewModel = NewObject<UHUDViewModel>(this);
+	HUDViewModel->SetCharacter(Cast<AMainCharacter>(GetPawn()));
+
+	// If HUDOverlayAsset is selected in the Blueprint, get the widget from the pool and add it to viewport
 	if (HUDOverlayAsset)
 	{
-		HUDOverlay = CreateWidget<UUserWidget>(this, HUDOverlayAsset);
+		HUDOverlay = AcquireWidget(HUDOverlayAsset);
 		if (HUDOverlay)
 		{
+			if (UHUDOverlayWidget* OverlayWidget = Cast<UHUDOverlayWidget>(HUDOverlay))
+			{
+				OverlayWidget->SetViewModel(HUDViewModel); // Overlays reparented to UHUDOverlayWidget, no property bindings
+			}
 			HUDOverlay->AddToViewport();
 			HUDOverlay->SetVisibility(ESlateVisibility::Visible);
 		}
 	}
 
-	// If WEnemyHealthBar is selected in the Blueprint, create the widget and add it to viewport
-	if (WEnemyHealthBar)
+	// The enemy health bars and the pause menu are built on first use, or before during the idle frames
+	if (UWidgetPoolSubsystem* WidgetPool = UWidgetPoolSubsystem::Get(this))
 	{
-		EnemyHealthBar = CreateWidget<UUserWidget>(this, WEnemyHealthBar);
-		if (EnemyHealthBar)
-		{
-			EnemyHealthBar->AddToViewport();
-			EnemyHealthBar->SetVisibility(ESlateVisibility::Hidden);
-		}
+		WidgetPool->Prewarm(WEnemyHealthBarLayer ? TSubclassOf<UUserWidget>(WEnemyHealthBarLayer) : WEnemyHealthBar);
+		WidgetPool->Prewarm(WPauseMenu);
+	}
+}
+
+// Called when the level ends (OpenLevel) or the controller is destroyed
+void AMainPlayerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The widgets go back to the pool for the next level, without the view-model of this one
+	if (UHUDOverlayWidget* OverlayWidget = Cast<UHUDOverlayWidget>(HUDOverlay))
+	{
+		OverlayWidget->SetViewModel(nullptr);
+	}
+	ReleaseWidget(HUDOverlay);
+	ReleaseWidget(EnemyHealthBar);
+	ReleaseWidget(PauseMenu);
+	if (EnemyHealthBarLayer)
+	{
+		EnemyHealthBarLayer->ClearBars();
+		UUserWidget* Layer = EnemyHealthBarLayer;
+		ReleaseWidget(Layer);
+		EnemyHealthBarLayer = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called for every widget of the controller
+UUserWidget* AMainPlayerController::AcquireWidget(TSubclassOf<UUserWidget> WidgetClass)
+{
+	if (UWidgetPoolSubsystem* WidgetPool = UWidgetPoolSubsystem::Get(this))
+	{
+		return WidgetPool->Acquire(this, WidgetClass);
+	}
+	return CreateWidget<UUserWidget>(this, WidgetClass);
+}
+
+// Called by EndPlay()
+void AMainPlayerController::ReleaseWidget(UUserWidget*& Widget)
+{
+	if (Widget == nullptr) return;
+
+	if (UWidgetPoolSubsystem* WidgetPool = UWidgetPoolSubsystem::Get(this))
+	{
+		WidgetPool->Release(Widget);
+	}
+	else
+	{
+		Widget->RemoveFromParent();
+	}
+	Widget = nullptr;
+}
+
+// Called by DisplayEnemyHealthBar() the first time
+void AMainPlayerController::CreateEnemyHealthBar()
+{
+	// If WEnemyHealthBar is selected in the Blueprint, get the widget from the pool and add it to viewport
+	EnemyHealthBar = AcquireWidget(WEnemyHealthBar);
+	if (EnemyHealthBar)
+	{
+		EnemyHealthBar->AddToViewport();
+		EnemyHealthBar->SetVisibility(ESlateVisibility::Hidden);
+
 		// Alignment of the HealthBar in the screen
 		FVector2D Alignment(0.f, 0.f);
 		EnemyHealthBar->SetAlignmentInViewport(Alignment);
 	}
+}
 
-	// If WPauseMenu is selected in the Blueprint, create the widget and add it to viewport
-	if (WPauseMenu)
+// Called by UpdateEnemyHealthBarLayer() the first time an enemy is engaged
+void AMainPlayerController::CreateEnemyHealthBarLayer()
+{
+	// Health bars of every engaged enemy, below the other widgets
+	EnemyHealthBarLayer = Cast<UEnemyHealthBarLayer>(AcquireWidget(WEnemyHealthBarLayer));
+	if (EnemyHealthBarLayer)
 	{
-		PauseMenu = CreateWidget<UUserWidget>(this, WPauseMenu);
-		if (PauseMenu)
-		{
-			PauseMenu->AddToViewport();
-			PauseMenu->SetVisibility(ESlateVisibility::Hidden);
-		}
+		EnemyHealthBarLayer->AddToViewport(-1);
+		EnemyHealthBarLayer->SetVisibility(ESlateVisibility::Collapsed);
+	}
+}
+
+// Called by TogglePauseMenu() the first time the menu opens
+void AMainPlayerController::CreatePauseMenu()
+{
+	// If WPauseMenu is selected in the Blueprint, get the widget from the pool and add it to viewport
+	PauseMenu = AcquireWidget(WPauseMenu);
+	if (PauseMenu)
+	{
+		PauseMenu->AddToViewport();
+		PauseMenu->SetVisibility(ESlateVisibility::Hidden);
+	}
+}
+
+// Called when the controller possesses a pawn
+void AMainPlayerController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	if (HUDViewModel)
+	{
+		HUDViewModel->SetCharacter(Cast<AMainCharacter>(InPawn));
 	}
 }
 
@@ -55,8 +156,14 @@ void AMainPlayerController::BeginPlay()
 void AMainPlayerController::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	// Functionality to display Enemy Health Bar above the enemy
-	if (EnemyHealthBar)
+
+	if (WEnemyHealthBarLayer)
+	{
+		UpdateEnemyHealthBarLayer();
+	}
+
+	// Functionality to display Enemy Health Bar above the enemy, nothing to do while it is hidden
+	if (EnemyHealthBar && bEnemyHealthBarVisible)
 	{
 		FVector2D PositionInViewport; // 2D Vector for the Enemy HealthBar location in the screen
 		ProjectWorldLocationToScreen(EnemyLocation, PositionInViewport); // Projecting the Enemy location in the screen
@@ -69,9 +176,58 @@ void AMainPlayerController::Tick(float DeltaTime)
 	}
 }
 
+// Called every frame when the enemy health bar layer is used
+void AMainPlayerController::UpdateEnemyHealthBarLayer()
+{
+	// Enemies that have the player in their combat range, nearest first
+	UEnemyManagerSubsystem* EnemyManager = UEnemyManagerSubsystem::Get(this);
+	AMainCharacter* MainCharacter = Cast<AMainCharacter>(GetPawn());
+	if (EnemyManager && MainCharacter)
+	{
+		// The live layer once it exists, a blueprint may have changed its MaxBars
+		const int32 MaxBars = EnemyHealthBarLayer ? EnemyHealthBarLayer->MaxBars : WEnemyHealthBarLayer->GetDefaultObject<UEnemyHealthBarLayer>()->MaxBars;
+		EnemyManager->GetNearestEnemiesInCombatRange(MaxBars, EngagedEnemies, MainCharacter->EnemyFilter);
+	}
+	else
+	{
+		EngagedEnemies.Reset();
+	}
+
+	// Out of combat, no projection and the collapsed layer isn't painted
+	if (EngagedEnemies.Num() == 0)
+	{
+		if (EnemyHealthBarLayer)
+		{
+			EnemyHealthBarLayer->ClearBars();
+		}
+		return;
+	}
+
+	if (EnemyHealthBarLayer == nullptr)
+	{
+		CreateEnemyHealthBarLayer();
+		if (EnemyHealthBarLayer == nullptr) return;
+	}
+
+	// View-projection matrix of the frame, computed once for every bar
+	ULocalPlayer* LocalPlayer = GetLocalPlayer();
+	if (LocalPlayer == nullptr || LocalPlayer->ViewportClient == nullptr) return;
+
+	FSceneViewProjectionData ProjectionData;
+	if (!LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, eSSP_FULL, ProjectionData)) return;
+
+	EnemyHealthBarLayer->UpdateBars(EngagedEnemies, ProjectionData.ComputeViewProjectionMatrix());
+}
+
 // Called when player is inside the CombatSphere of an enemy
 void AMainPlayerController::DisplayEnemyHealthBar()
 {
+	// The layer shows the engaged enemies by itself
+	if (EnemyHealthBar == nullptr && WEnemyHealthBar && WEnemyHealthBarLayer == nullptr)
+	{
+		CreateEnemyHealthBar();
+	}
+
 	if (EnemyHealthBar)
 	{
 		bEnemyHealthBarVisible = true;
@@ -115,6 +271,10 @@ void AMainPlayerController::TogglePauseMenu()
 {
 	if (!bPauseMenuOpen)
 	{
+		if (PauseMenu == nullptr && WPauseMenu)
+		{
+			CreatePauseMenu(); // Before the Blueprint shows it
+		}
 		DisplayPauseMenu();
 	}
 	else
@@ -128,4 +288,4 @@ void AMainPlayerController::GameModeOnly()
 {
 	FInputModeGameOnly InputModeGameOnly;
 	SetInputMode(InputModeGameOnly);
-}
\ No newline at end of file
+}
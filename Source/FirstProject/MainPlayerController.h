@@ -30,6 +30,10 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Widgets")
 	UUserWidget* HUDOverlay;
 
+	/** Stats shown by the HUD, pushed by the character when they change */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Widgets")
+	class UHUDViewModel* HUDViewModel;
+
 	/** Reference to the UMG asset in the editor */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Widgets")
 	TSubclassOf<UUserWidget> WEnemyHealthBar;
@@ -38,6 +42,14 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Widgets")
 	UUserWidget* EnemyHealthBar;
 
+	/** Layer drawing the health bars of every engaged enemy, used instead of WEnemyHealthBar when set (clear it to go back to the single bar) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Widgets")
+	TSubclassOf<class UEnemyHealthBarLayer> WEnemyHealthBarLayer;
+
+	/** Variable to hold the layer after creating it */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Widgets")
+	UEnemyHealthBarLayer* EnemyHealthBarLayer;
+
 	/** Reference to the UMG asset in the editor */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Widgets")
 	TSubclassOf<UUserWidget> WPauseMenu;
@@ -56,10 +68,19 @@ public:
 	/** Vector to store the Enemy location in the world to display the EnemyHealthBar */
 	FVector EnemyLocation;
 
+	/** Engaged enemies of the frame, the array keeps its memory between frames */
+	TArray<class AEnemy*> EngagedEnemies;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the controller possesses a pawn, the HUD view-model listens to the new character
+	virtual void OnPossess(APawn* InPawn) override;
+
+	// Called when the level ends, the widgets go back to the widget pool
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -70,6 +91,20 @@ public:
 	/** Hide Enemy Health Bar */
 	void RemoveEnemyHealthBar();
 
+	/** Projects the engaged enemies for the health bar layer, collapses it when there are none */
+	void UpdateEnemyHealthBarLayer();
+
+	/** Widget of the class from the widget pool, owned by this controller */
+	UUserWidget* AcquireWidget(TSubclassOf<UUserWidget> WidgetClass);
+
+	/** Gives the widget back to the widget pool and clears the variable */
+	void ReleaseWidget(UUserWidget*& Widget);
+
+	/** Rarely used widgets, built on first use (or prewarmed by the widget pool) */
+	void CreateEnemyHealthBar();
+	void CreateEnemyHealthBarLayer();
+	void CreatePauseMenu();
+
 	/** Open Pause Menu */
 	UFUNCTION(BlueprintNativeEvent)
 	void DisplayPauseMenu();
@@ -5,6 +5,8 @@
 #include "Kismet/GameplayStatics.h"
 #include "Engine/World.h"
 #include "Sound/SoundCue.h"
+#include "FXPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
 
 // Sets default values
 APickup::APickup()
@@ -31,11 +33,11 @@ void APickup::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* O
 
 			if (OverlapParticles)
 			{
-				UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), OverlapParticles, GetActorLocation(), FRotator(0.f), true); // Particle effect when player overlaps with pickup
+				UFXPoolSubsystem::SpawnEffectAtLocation(this, OverlapParticles, GetActorLocation()); // Particle effect when player overlaps with pickup (pooled)
 			}
 			if (OverlapSound)
 			{
-				UGameplayStatics::PlaySound2D(this, OverlapSound); // Sound effect when player overlaps with pickup
+				UCombatAudioSubsystem::PlayCue(this, OverlapSound, GetActorLocation(), 2.f); // Sound effect when player overlaps with pickup
 			}
 
 			Destroy();
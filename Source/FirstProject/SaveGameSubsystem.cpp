@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SaveGameSubsystem.h"
+#include "FirstProject.h"
+#include "Async/Async.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/SaveGame.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Save Flush"), STAT_SaveFlush, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Saves Written"), STAT_SavesWritten, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Saves Coalesced"), STAT_SavesCoalesced, STATGROUP_Gameplay);
+
+
+// Sets default values
+USaveGameSubsystem::USaveGameSubsystem()
+{
+	bSaveInFlight = false;
+}
+
+// Returns the save subsystem of the game instance of the world the object lives in
+USaveGameSubsystem* USaveGameSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<USaveGameSubsystem>() : nullptr;
+}
+
+// Called by AMainCharacter::SaveGame()
+void USaveGameSubsystem::SaveGameToSlot(const UObject* WorldContextObject, USaveGame* SaveObject, const FString& SlotName, int32 UserIndex)
+{
+	if (USaveGameSubsystem* Subsystem = Get(WorldContextObject))
+	{
+		Subsystem->SaveGameAsync(SaveObject, SlotName, UserIndex);
+	}
+	else
+	{
+		UGameplayStatics::SaveGameToSlot(SaveObject, SlotName, UserIndex);
+	}
+}
+
+// Called when the game instance shuts down
+void USaveGameSubsystem::Deinitialize()
+{
+	FlushSaves();
+
+	Super::Deinitialize();
+}
+
+// Only tick while a save is being written
+bool USaveGameSubsystem::IsTickable() const
+{
+	return !IsTemplate() && bSaveInFlight;
+}
+
+// Stat used by the engine to time the tickable object
+TStatId USaveGameSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USaveGameSubsystem, STATGROUP_Tickables);
+}
+
+// Called every frame
+void USaveGameSubsystem::Tick(float DeltaTime)
+{
+	if (bSaveInFlight && InFlightResult.IsReady())
+	{
+		FinishSave(InFlightResult.Get());
+	}
+}
+
+// Called when saving the game
+void USaveGameSubsystem::SaveGameAsync(USaveGame* SaveObject, const FString& SlotName, int32 UserIndex, FSaveGameFinishedDelegate OnFinished)
+{
+	if (SaveObject == nullptr || SlotName.IsEmpty())
+	{
+		OnFinished.ExecuteIfBound(SlotName, UserIndex, false);
+		return;
+	}
+
+	// A newer save of a slot replaces the one still waiting, the slot is written once with the newest data
+	FPendingSave* Pending = PendingSaves.FindByPredicate([&](const FPendingSave& Save) { return Save.UserIndex == UserIndex && Save.SlotName == SlotName; });
+	if (Pending)
+	{
+		Pending->SaveObject = SaveObject;
+		INC_DWORD_STAT(STAT_SavesCoalesced);
+	}
+	else
+	{
+		Pending = &PendingSaves.AddDefaulted_GetRef();
+		Pending->SaveObject = SaveObject;
+		Pending->SlotName = SlotName;
+		Pending->UserIndex = UserIndex;
+	}
+	if (OnFinished.IsBound())
+	{
+		Pending->Callbacks.Add(MoveTemp(OnFinished));
+	}
+
+	if (!bSaveInFlight)
+	{
+		StartNextSave();
+	}
+}
+
+// Called before a save slot is read, and when the game instance shuts down
+void USaveGameSubsystem::FlushSaves()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SaveFlush);
+
+	// FinishSave() starts the next pending save, wait until there is none
+	while (bSaveInFlight)
+	{
+		FinishSave(InFlightResult.Get());
+	}
+}
+
+// Called by SaveGameAsync() and FinishSave()
+void USaveGameSubsystem::StartNextSave()
+{
+	if (PendingSaves.Num() == 0) return;
+
+	InFlightSave = MoveTemp(PendingSaves[0]);
+	PendingSaves.RemoveAt(0, 1, false);
+	bSaveInFlight = true;
+
+	// The save object is kept alive by InFlightSave and nothing writes to it anymore, the worker only reads it
+	USaveGame* SaveObject = InFlightSave.SaveObject;
+	const FString SlotName = InFlightSave.SlotName;
+	const int32 UserIndex = InFlightSave.UserIndex;
+	InFlightResult = Async(EAsyncExecution::ThreadPool, [SaveObject, SlotName, UserIndex]()
+	{
+		TArray<uint8> Data;
+		return UGameplayStatics::SaveGameToMemory(SaveObject, Data) && UGameplayStatics::SaveDataToSlot(Data, SlotName, UserIndex);
+	});
+}
+
+// Called by Tick() once the worker is done, or by FlushSaves()
+void USaveGameSubsystem::FinishSave(bool bSuccess)
+{
+	FPendingSave Save = MoveTemp(InFlightSave);
+	InFlightSave = FPendingSave();
+	InFlightResult = TFuture<bool>();
+	bSaveInFlight = false;
+
+	if (bSuccess)
+	{
+		INC_DWORD_STAT(STAT_SavesWritten);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Saving to slot %s (user %d) failed"), *Save.SlotName, Save.UserIndex);
+	}
+
+	// Next save first, so a callback that saves again is merged into the pending ones
+	StartNextSave();
+
+	for (FSaveGameFinishedDelegate& Callback : Save.Callbacks)
+	{
+		Callback.ExecuteIfBound(Save.SlotName, Save.UserIndex, bSuccess);
+	}
+	OnSaveGameFinished.Broadcast(Save.SlotName, bSuccess);
+}
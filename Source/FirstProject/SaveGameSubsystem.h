@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Game instance subsystem that writes the save games in the background. The caller fills the save game object on
+ * the game thread (cheap copy of the stats) and hands it over, the serialization and the file write run on the
+ * thread pool, one save at a time, and the result comes back on the game thread through a delegate. Saves asked
+ * for the same slot while another one is waiting are merged, only the newest object is written. The pending saves
+ * are flushed before a save slot is loaded and when the game instance shuts down.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "SaveGameSubsystem.generated.h"
+
+class USaveGame;
+
+/** Called on the game thread once the save is on disk (or failed) */
+DECLARE_DELEGATE_ThreeParams(FSaveGameFinishedDelegate, const FString& /*SlotName*/, int32 /*UserIndex*/, bool /*bSuccess*/);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnSaveGameFinished, const FString&, SlotName, bool, bSuccess);
+
+/** Save game waiting to be written, or being written */
+USTRUCT()
+struct FPendingSave
+{
+	GENERATED_BODY()
+
+	/** Not changed after it is handed to the subsystem, the worker thread reads it */
+	UPROPERTY()
+	USaveGame* SaveObject = nullptr;
+
+	FString SlotName;
+	int32 UserIndex = 0;
+
+	/** Delegates of every save merged into this one */
+	TArray<FSaveGameFinishedDelegate> Callbacks;
+};
+
+/**
+ *
+ */
+UCLASS()
+class FIRSTPROJECT_API USaveGameSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	USaveGameSubsystem();
+
+	/** Helper to get the save subsystem of the game instance of the world the object lives in */
+	static USaveGameSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Saves through the subsystem when there is one, with UGameplayStatics::SaveGameToSlot() otherwise */
+	static void SaveGameToSlot(const UObject* WorldContextObject, USaveGame* SaveObject, const FString& SlotName, int32 UserIndex);
+
+	/** Inherited from UGameInstanceSubsystem, writes the pending saves before the game instance goes away */
+	virtual void Deinitialize() override;
+
+	/** Inherited from FTickableGameObject, waits for the save being written */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+	/** Writes the save object to the slot in the background
+	/* @param SaveObject: must not be changed afterwards, fill a new one for the next save
+	/* @param OnFinished: called on the game thread once the save object, or a newer one of the same slot, is written */
+	void SaveGameAsync(USaveGame* SaveObject, const FString& SlotName, int32 UserIndex, FSaveGameFinishedDelegate OnFinished = FSaveGameFinishedDelegate());
+
+	/** Blocks until every pending save is written, call before reading a save slot */
+	void FlushSaves();
+
+	/** True while a save is being written or waiting to be */
+	UFUNCTION(BlueprintPure, Category = "SaveGame")
+	bool IsSaving() const { return bSaveInFlight || PendingSaves.Num() > 0; }
+
+	/** Broadcast on the game thread every time a save is written (or failed) */
+	UPROPERTY(BlueprintAssignable, Category = "SaveGame")
+	FOnSaveGameFinished OnSaveGameFinished;
+
+private:
+	/** Hands the oldest pending save to the thread pool */
+	void StartNextSave();
+
+	/** Calls the delegates of the save being written and starts the next one */
+	void FinishSave(bool bSuccess);
+
+	/** Saves waiting for the one being written, one per slot */
+	UPROPERTY()
+	TArray<FPendingSave> PendingSaves;
+
+	/** Save being written */
+	UPROPERTY()
+	FPendingSave InFlightSave;
+
+	bool bSaveInFlight;
+	TFuture<bool> InFlightResult;
+};
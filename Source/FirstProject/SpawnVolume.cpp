@@ -7,6 +7,7 @@
 #include "Engine/World.h"
 #include "Enemy.h"
 #include "AIController.h"
+#include "EnemyPoolSubsystem.h"
 
 // Sets default values
 ASpawnVolume::ASpawnVolume()
@@ -19,6 +20,8 @@ ASpawnVolume::ASpawnVolume()
 	
 	SpawningBox->bHiddenInGame = true;
 
+	PoolPrewarmCount = 0;
+
 }
 
 // Called when the game starts or when spawned
@@ -33,7 +36,19 @@ void ASpawnVolume::BeginPlay()
 		SpawnArray.Add(Actor_3);
 		SpawnArray.Add(Actor_4);
 	}
-	
+
+	// Filling the enemy pool so the first waves reuse parked enemies instead of spawning them
+	UEnemyPoolSubsystem* EnemyPool = UEnemyPoolSubsystem::Get(this);
+	if (EnemyPool && PoolPrewarmCount > 0)
+	{
+		for (const TSubclassOf<AActor>& SpawnClass : SpawnArray)
+		{
+			if (SpawnClass && SpawnClass->IsChildOf(AEnemy::StaticClass()))
+			{
+				EnemyPool->Prewarm(*SpawnClass, PoolPrewarmCount, GetActorLocation());
+			}
+		}
+	}
 }
 
 // Called every frame
@@ -79,6 +94,14 @@ void ASpawnVolume::SpawnOurActor_Implementation(UClass* ToSpawn, const FVector&
 		UWorld* World = GetWorld();
 		FActorSpawnParameters SpawnParams;
 
+		// Enemies are taken from the enemy pool, it only spawns a new one (with its controller) when no enemy is parked
+		UEnemyPoolSubsystem* EnemyPool = UEnemyPoolSubsystem::Get(this);
+		if (EnemyPool && ToSpawn->IsChildOf(AEnemy::StaticClass()))
+		{
+			EnemyPool->AcquireEnemy(ToSpawn, Location, FRotator(0.f));
+			return;
+		}
+
 		if (World)
 		{
 			// Actor is spawned in the world, stored in case its an enemy
@@ -36,6 +36,10 @@ public:
 	/** TArray to store the actors */
 	TArray<TSubclassOf<AActor>> SpawnArray;
 
+	/** Number of enemies of every enemy class of the volume spawned and parked in the enemy pool when the level starts */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning)
+	int32 PoolPrewarmCount;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
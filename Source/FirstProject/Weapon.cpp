@@ -9,6 +9,10 @@
 #include "Particles/ParticleSystemComponent.h"
 #include "Components/BoxComponent.h"
 #include "Enemy.h"
+#include "CombatQuerySubsystem.h"
+#include "DamageQueueSubsystem.h"
+#include "FXPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
 
 
 // Sets default values
@@ -24,6 +28,7 @@ AWeapon::AWeapon()
 	//Initializing values
 	bWeaponParticles = false;
 	Damage = 50.f;
+	SwingId = 0;
 	//Initializing the Enum
 	WeaponState = EWeaponState::EWS_Pickup;
 }
@@ -99,7 +104,7 @@ void AWeapon::Equip(AMainCharacter* MainCharacter)
 		}
 		
 		// Playing a sound cue when equipping a weapon
-		if (OnEquipSound) UGameplayStatics::PlaySound2D(this, OnEquipSound);
+		if (OnEquipSound) UCombatAudioSubsystem::PlayCue(this, OnEquipSound, GetActorLocation(), 2.f);
 		
 		// Playing particle effects on the weapon while equipped
 		if (!bWeaponParticles)
@@ -121,31 +126,47 @@ void AWeapon::HitboxOnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AAc
 		AEnemy* Enemy = Cast<AEnemy>(OtherActor); // Casting Enemy (to apply damage)
 		if (Enemy)
 		{
-			// Particles when the weapon hitbox hits the enemy
-			if (Enemy->HitParticles)
-			{
-				const USkeletalMeshSocket* WeaponSocket = SkeletalMesh->GetSocketByName("WeaponSocket"); // Creating a weapon socket reference
-				if (WeaponSocket)
-				{
-					// Spawning the particle system at the weapon socket
-					FVector SocketLocation = WeaponSocket->GetSocketLocation(SkeletalMesh);
-					UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Enemy->HitParticles, SocketLocation, FRotator(0.f), false);
-				}
-			}
-			// Playing the enemy hit sound
-			if (Enemy->HitSound)
-			{
-				UGameplayStatics::PlaySound2D(this, Enemy->HitSound);
-			}
-			// Applying damage to enemy
-			if (DamageTypeClass)
-			{
-				UGameplayStatics::ApplyDamage(Enemy, Damage, WeaponInstigator, this, DamageTypeClass);
-			}
+			HitEnemy(Enemy);
 		}
 	}
 }
 
+// Called by the melee sweeps of UCombatQuerySubsystem once per actor the swing went through
+void AWeapon::HitboxOnSweepHit(const FHitResult& Hit)
+{
+	AEnemy* Enemy = Cast<AEnemy>(Hit.GetActor());
+	if (Enemy)
+	{
+		HitEnemy(Enemy);
+	}
+}
+
+// Called when the weapon hitbox overlaps or sweeps through an enemy
+void AWeapon::HitEnemy(AEnemy* Enemy)
+{
+	// Applying damage to enemy, at the end of the frame and once per swing. No effects either when the swing already hit it
+	if (DamageTypeClass && !UDamageQueueSubsystem::ApplyDamage(Enemy, Damage, WeaponInstigator, this, DamageTypeClass, SwingId))
+	{
+		return;
+	}
+	// Particles when the weapon hitbox hits the enemy
+	if (Enemy->HitParticles)
+	{
+		const USkeletalMeshSocket* WeaponSocket = SkeletalMesh->GetSocketByName("WeaponSocket"); // Creating a weapon socket reference
+		if (WeaponSocket)
+		{
+			// Playing the particle system at the weapon socket, from the effects pool
+			FVector SocketLocation = WeaponSocket->GetSocketLocation(SkeletalMesh);
+			UFXPoolSubsystem::SpawnEffectAtLocation(this, Enemy->HitParticles, SocketLocation);
+		}
+	}
+	// Playing the enemy hit sound
+	if (Enemy->HitSound)
+	{
+		UCombatAudioSubsystem::PlayCue(this, Enemy->HitSound, Enemy->GetActorLocation(), 2.f); // Hits of the player are heard over the enemies
+	}
+}
+
 // Function not used
 void AWeapon::HitboxOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
@@ -155,12 +176,25 @@ void AWeapon::HitboxOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActo
 // Called when player attacks (in Blueprints)
 void AWeapon::ActivateHitbox()
 {
+	++SwingId; // New attack, the enemies hit by the last one can be hit again
+	// Swept hits don't depend on the frame rate and run in the combat query batch, the overlap events are kept behind fp.CombatQueries 0
+	UCombatQuerySubsystem* CombatQueries = UCombatQuerySubsystem::Get(this);
+	if (CombatQueries && UCombatQuerySubsystem::UseCombatQueries())
+	{
+		// The character holding the weapon can't be hit by its own swing
+		CombatQueries->BeginSweep(Hitbox, GetAttachParentActor(), FOnCombatQueryHit::CreateUObject(this, &AWeapon::HitboxOnSweepHit));
+		return;
+	}
 	Hitbox->SetCollisionEnabled(ECollisionEnabled::QueryOnly); // QueryOnly = Only overlap is enabled, no physics
 }
 
 // Called after finishing an attack animation (in Blueprints)
 void AWeapon::DeactivateHitbox()
 {
+	if (UCombatQuerySubsystem* CombatQueries = UCombatQuerySubsystem::Get(this))
+	{
+		CombatQueries->EndSweep(Hitbox);
+	}
 	Hitbox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 }
 
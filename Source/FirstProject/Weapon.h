@@ -69,6 +69,9 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat")
 	TSubclassOf<UDamageType> DamageTypeClass;
 
+	/** Attack in progress, the damage queue applies the damage of an attack once per enemy */
+	uint32 SwingId;
+
 	/** Instigator for the ApplyDamage() Function used in HitboxOnOverlapBegin() */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Combat")
 	AController* WeaponInstigator;
@@ -95,7 +98,13 @@ public:
 	UFUNCTION()
 	void HitboxOnOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	/** Enable/Disable weapon hitbox */
+	/** Called by UCombatQuerySubsystem when the swept hitbox hits an actor */
+	void HitboxOnSweepHit(const FHitResult& Hit);
+
+	/** Particles, sound and damage when the weapon hits the enemy */
+	void HitEnemy(class AEnemy* Enemy);
+
+	/** Enable/Disable weapon hitbox, swept between frames or with overlap events depending on fp.CombatQueries */
 	UFUNCTION(BlueprintCallable)
 	void ActivateHitbox();
 	UFUNCTION(BlueprintCallable)
@@ -0,0 +1,291 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WidgetPoolSubsystem.h"
+#include "FirstProject.h"
+#include "Blueprint/UserWidget.h"
+#include "Blueprint/WidgetTree.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/UnrealType.h"
+
+DECLARE_CYCLE_STAT(TEXT("Widget Creation"), STAT_WidgetCreation, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Widgets Created"), STAT_WidgetsCreated, STATGROUP_Gameplay);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Widgets Reused"), STAT_WidgetsReused, STATGROUP_Gameplay);
+
+static TAutoConsoleVariable<int32> CVarWidgetPool(
+	TEXT("fp.WidgetPool"),
+	1,
+	TEXT("0: every Acquire() creates a new widget and released widgets are dropped, the level load log gives the time to first frame without the pool,\n")
+	TEXT("1: widgets are kept across the levels and reused.\n")
+	TEXT("Applied to the next Acquire() and Release()"));
+
+
+// Sets default values
+UWidgetPoolSubsystem::UWidgetPoolSubsystem()
+{
+	// Defaults, can be overridden in DefaultGame.ini
+	PrewarmDelay = 1.f;
+	IdleFrameTime = 0.025f;
+	MaxFreePerClass = 2;
+
+	bWaitingFirstFrame = false;
+	LoadStartTime = 0.0;
+	LoadEndTime = 0.0;
+	PrewarmStartTime = 0.0;
+	NumCreated = 0;
+	NumReused = 0;
+	CreateTime = 0.0;
+}
+
+// Returns the widget pool of the game instance of the world the object lives in
+UWidgetPoolSubsystem* UWidgetPoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UWidgetPoolSubsystem>() : nullptr;
+}
+
+// Called when the game instance is created
+void UWidgetPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &UWidgetPoolSubsystem::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UWidgetPoolSubsystem::OnPostLoadMap);
+	PrewarmStartTime = FPlatformTime::Seconds() + PrewarmDelay;
+}
+
+// Called when the game instance shuts down
+void UWidgetPoolSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	Pools.Empty();
+	PrewarmQueue.Empty();
+
+	Super::Deinitialize();
+}
+
+// Only tick while a level load is measured or widgets wait to be prewarmed
+bool UWidgetPoolSubsystem::IsTickable() const
+{
+	return !IsTemplate() && (bWaitingFirstFrame || PrewarmQueue.Num() > 0);
+}
+
+// Stat used by the engine to time the tickable object
+TStatId UWidgetPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWidgetPoolSubsystem, STATGROUP_Tickables);
+}
+
+// Called every frame
+void UWidgetPoolSubsystem::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	// First frame of the new level
+	if (bWaitingFirstFrame && LoadEndTime > 0.0)
+	{
+		bWaitingFirstFrame = false;
+		const FString Result = FString::Printf(TEXT("Level %s: first frame %.1f ms after the load started (map loaded in %.1f ms), %d widgets created in %.2f ms, %d reused"),
+			*LoadingMapName, (Now - LoadStartTime) * 1000.0, (LoadEndTime - LoadStartTime) * 1000.0, NumCreated, CreateTime * 1000.0, NumReused);
+		UE_LOG(LogTemp, Log, TEXT("%s"), *Result);
+
+		PrewarmStartTime = Now + PrewarmDelay;
+		return;
+	}
+
+	// One widget per idle frame
+	if (PrewarmQueue.Num() == 0 || Now < PrewarmStartTime || FApp::GetDeltaTime() > IdleFrameTime) return;
+
+	const TSubclassOf<UUserWidget> WidgetClass = PrewarmQueue[0];
+	PrewarmQueue.RemoveAt(0, 1, false);
+	if (WidgetClass == nullptr) return;
+
+	FWidgetPoolList& Pool = Pools.FindOrAdd(WidgetClass);
+	if (Pool.Free.Num() > 0 || Pool.InUse.Num() > 0) return; // Built on first use in the meantime
+
+	if (UUserWidget* Widget = CreatePooledWidget(WidgetClass))
+	{
+		Pool.Free.Add(Widget);
+	}
+}
+
+// Called by AMainPlayerController when it needs a widget
+UUserWidget* UWidgetPoolSubsystem::Acquire(APlayerController* OwningPlayer, TSubclassOf<UUserWidget> WidgetClass)
+{
+	if (WidgetClass == nullptr) return nullptr;
+
+	FWidgetPoolList& Pool = Pools.FindOrAdd(WidgetClass);
+	UUserWidget* Widget = nullptr;
+	while (Pool.Free.Num() > 0 && Widget == nullptr && CVarWidgetPool.GetValueOnGameThread() != 0)
+	{
+		Widget = Pool.Free.Pop(false);
+		if (!IsValid(Widget)) Widget = nullptr;
+	}
+	if (Widget)
+	{
+		++NumReused;
+		INC_DWORD_STAT(STAT_WidgetsReused);
+	}
+	else
+	{
+		Widget = CreatePooledWidget(WidgetClass);
+		if (Widget == nullptr) return nullptr;
+	}
+
+	if (OwningPlayer)
+	{
+		Widget->SetOwningPlayer(OwningPlayer);
+	}
+	Pool.InUse.Add(Widget);
+	return Widget;
+}
+
+// Called by AMainPlayerController when it ends play, and for the widgets still in use when a level load starts
+void UWidgetPoolSubsystem::Release(UUserWidget* Widget)
+{
+	if (Widget == nullptr) return;
+
+	FWidgetPoolList* Pool = Pools.Find(Widget->GetClass());
+	if (Pool == nullptr || Pool->InUse.RemoveSingleSwap(Widget, false) == 0) return; // Not from the pool or already released
+
+	// No reference to the player controller or any other object of the old level
+	Widget->RemoveFromParent();
+	Widget->SetPlayerContext(FLocalPlayerContext());
+	ClearWorldReferences(Widget);
+
+	if (Pool->Free.Num() < MaxFreePerClass && CVarWidgetPool.GetValueOnGameThread() != 0)
+	{
+		Pool->Free.Add(Widget);
+	}
+}
+
+// Called by AMainPlayerController for the widgets it doesn't need right away
+void UWidgetPoolSubsystem::Prewarm(TSubclassOf<UUserWidget> WidgetClass)
+{
+	if (WidgetClass == nullptr) return;
+
+	const FWidgetPoolList* Pool = Pools.Find(WidgetClass);
+	if (Pool && (Pool->Free.Num() > 0 || Pool->InUse.Num() > 0)) return;
+
+	PrewarmQueue.AddUnique(WidgetClass);
+}
+
+// Called by UGameEngine::LoadMap() before the current world is torn down (OpenLevel)
+void UWidgetPoolSubsystem::OnPreLoadMap(const FString& MapName)
+{
+	for (auto& Pair : Pools)
+	{
+		TArray<UUserWidget*> InUse = Pair.Value.InUse;
+		for (UUserWidget* Widget : InUse)
+		{
+			Release(Widget);
+		}
+	}
+
+	bWaitingFirstFrame = true;
+	LoadStartTime = FPlatformTime::Seconds();
+	LoadEndTime = 0.0;
+	LoadingMapName = MapName;
+	NumCreated = 0;
+	NumReused = 0;
+	CreateTime = 0.0;
+}
+
+// Called by UGameEngine::LoadMap() once the new world is loaded
+void UWidgetPoolSubsystem::OnPostLoadMap(UWorld* World)
+{
+	LoadEndTime = FPlatformTime::Seconds();
+}
+
+// Called by ClearWorldReferences() for the pooled widget and every user widget nested in it
+static int32 ClearBlueprintWorldReferences(UUserWidget* Widget)
+{
+	auto IsInWorld = [](const UObject* Object)
+	{
+		return Object && (Object->IsA<UWorld>() || Object->GetTypedOuter<UWorld>() != nullptr);
+	};
+
+	// Only the Blueprint variables (HUD_Overlay, PauseMenu...), the native ones are cleared by their owners
+	int32 NumCleared = 0;
+	for (TFieldIterator<FProperty> It(Widget->GetClass()); It; ++It)
+	{
+		FProperty* Property = *It;
+		const UClass* OwnerClass = Property->GetOwnerClass();
+		if (OwnerClass == nullptr || OwnerClass->HasAnyClassFlags(CLASS_Native)) continue;
+
+		if (FObjectPropertyBase* ObjectProperty = CastField<FObjectPropertyBase>(Property))
+		{
+			for (int32 i = 0; i < ObjectProperty->ArrayDim; ++i)
+			{
+				void* Value = ObjectProperty->ContainerPtrToValuePtr<void>(Widget, i);
+				if (IsInWorld(ObjectProperty->GetObjectPropertyValue(Value)))
+				{
+					ObjectProperty->SetObjectPropertyValue(Value, nullptr);
+					++NumCleared;
+				}
+			}
+		}
+		else if (FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+		{
+			FObjectPropertyBase* InnerProperty = CastField<FObjectPropertyBase>(ArrayProperty->Inner);
+			if (InnerProperty == nullptr) continue;
+
+			FScriptArrayHelper_InContainer Array(ArrayProperty, Widget);
+			for (int32 i = 0; i < Array.Num(); ++i)
+			{
+				if (IsInWorld(InnerProperty->GetObjectPropertyValue(Array.GetRawPtr(i))))
+				{
+					InnerProperty->SetObjectPropertyValue(Array.GetRawPtr(i), nullptr);
+					++NumCleared;
+				}
+			}
+		}
+	}
+	return NumCleared;
+}
+
+// Called by Release(), the widget outlives the level so it must not keep it alive
+void UWidgetPoolSubsystem::ClearWorldReferences(UUserWidget* Widget)
+{
+	int32 NumCleared = ClearBlueprintWorldReferences(Widget);
+
+	// The user widgets placed in the designer (health bars, buttons...) are pooled with their parent and can point to the level too
+	if (Widget->WidgetTree)
+	{
+		Widget->WidgetTree->ForEachWidget([&NumCleared](UWidget* Child)
+		{
+			if (UUserWidget* ChildUserWidget = Cast<UUserWidget>(Child))
+			{
+				NumCleared += ClearBlueprintWorldReferences(ChildUserWidget);
+			}
+		});
+	}
+
+	if (NumCleared > 0)
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("%s released to the pool, %d references to level objects cleared"), *Widget->GetName(), NumCleared);
+	}
+}
+
+// Called by Acquire() and Tick()
+UUserWidget* UWidgetPoolSubsystem::CreatePooledWidget(TSubclassOf<UUserWidget> WidgetClass)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WidgetCreation);
+
+	const double StartTime = FPlatformTime::Seconds();
+	UUserWidget* Widget = CreateWidget<UUserWidget>(GetGameInstance(), WidgetClass);
+	CreateTime += FPlatformTime::Seconds() - StartTime;
+
+	if (Widget)
+	{
+		++NumCreated;
+		INC_DWORD_STAT(STAT_WidgetsCreated);
+	}
+	return Widget;
+}
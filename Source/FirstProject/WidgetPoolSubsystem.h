@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Game instance subsystem that keeps the widgets of AMainPlayerController in a pool per widget class, so they
+ * survive the level changes instead of being rebuilt after every OpenLevel. Widgets are created with the game
+ * instance as outer and only get an owning player while they are in use. Rarely used widgets are built on first
+ * use or during idle frames after the level started (prewarm). The time between the start of a level load and
+ * the first frame of the new level is measured and logged, with the widgets created and reused on the way.
+ * fp.WidgetPool 0 turns the reuse off to compare the load times without the pool.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "WidgetPoolSubsystem.generated.h"
+
+class UUserWidget;
+class APlayerController;
+
+/** Widgets of one class */
+USTRUCT()
+struct FWidgetPoolList
+{
+	GENERATED_BODY()
+
+	/** Widgets out of the viewport, ready to be used */
+	UPROPERTY()
+	TArray<UUserWidget*> Free;
+
+	/** Widgets used by a player controller */
+	UPROPERTY()
+	TArray<UUserWidget*> InUse;
+};
+
+/**
+ * Settings are read from the [/Script/FirstProject.WidgetPoolSubsystem] section of DefaultGame.ini
+ */
+UCLASS(config = Game)
+class FIRSTPROJECT_API UWidgetPoolSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+public:
+	// Sets default values
+	UWidgetPoolSubsystem();
+
+	/** Helper to get the widget pool of the game instance of the world the object lives in */
+	static UWidgetPoolSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Inherited from UGameInstanceSubsystem, starts listening to the level loads */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Inherited from UGameInstanceSubsystem, forgets the widgets */
+	virtual void Deinitialize() override;
+
+	/** Inherited from FTickableGameObject, measures the first frame of a level and prewarms during the idle frames */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+	/** Widget of the class owned by the player, from the pool when there is one, created otherwise. Not added to the viewport */
+	UUserWidget* Acquire(APlayerController* OwningPlayer, TSubclassOf<UUserWidget> WidgetClass);
+
+	template<class WidgetType>
+	WidgetType* Acquire(APlayerController* OwningPlayer, TSubclassOf<UUserWidget> WidgetClass)
+	{
+		return Cast<WidgetType>(Acquire(OwningPlayer, WidgetClass));
+	}
+
+	/** Removes the widget from the viewport, clears its references to the level and keeps it for the next Acquire() of its class,
+	/* in this level or the next ones */
+	void Release(UUserWidget* Widget);
+
+	/** Builds a widget of the class during the next idle frames, unless the class already has one */
+	void Prewarm(TSubclassOf<UUserWidget> WidgetClass);
+
+	/** Seconds after the first frame of a level before the prewarm starts, the first frames of a level are busy enough */
+	UPROPERTY(config)
+	float PrewarmDelay;
+
+	/** Only frames shorter than this (seconds) build a prewarmed widget, one widget per frame */
+	UPROPERTY(config)
+	float IdleFrameTime;
+
+	/** Max free widgets kept per class */
+	UPROPERTY(config)
+	int32 MaxFreePerClass;
+
+private:
+	/** Bound to FCoreUObjectDelegates::PreLoadMap, the widgets in use go back to the pool before the world goes away */
+	void OnPreLoadMap(const FString& MapName);
+
+	/** Bound to FCoreUObjectDelegates::PostLoadMapWithWorld */
+	void OnPostLoadMap(UWorld* World);
+
+	/** Clears the Blueprint variables of the widget, and of the user widgets in its widget tree, that point to an actor,
+	/* a component or any other object of a level */
+	void ClearWorldReferences(UUserWidget* Widget);
+
+	/** Creates a widget of the class with the game instance as outer */
+	UUserWidget* CreatePooledWidget(TSubclassOf<UUserWidget> WidgetClass);
+
+	/** Pools by widget class */
+	UPROPERTY()
+	TMap<UClass*, FWidgetPoolList> Pools;
+
+	/** Classes waiting for an idle frame to be built */
+	UPROPERTY()
+	TArray<TSubclassOf<UUserWidget>> PrewarmQueue;
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+
+	/** Level load being measured, FPlatformTime::Seconds() of its steps */
+	bool bWaitingFirstFrame;
+	double LoadStartTime;
+	double LoadEndTime;
+	FString LoadingMapName;
+
+	/** No prewarm before this time (FPlatformTime::Seconds()) */
+	double PrewarmStartTime;
+
+	/** Widgets created and reused since the last level load started, and the time spent creating them */
+	int32 NumCreated;
+	int32 NumReused;
+	double CreateTime;
+};